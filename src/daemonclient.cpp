@@ -19,14 +19,26 @@
 
 #include "daemonclient.h"
 
+#include "systempaths.h"
+#include "tracescope.h"
+
+#include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QMessageBox>
 
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
 
+namespace
+{
+const bool s_configFdEnabled = qEnvironmentVariableIsSet("OPTIMUS_MANAGER_QT_CONFIG_FD");
+}
+
 DaemonClient::DaemonClient(QObject *parent)
     : QObject(parent)
 {
@@ -39,6 +51,7 @@ DaemonClient::~DaemonClient()
 
 void DaemonClient::connect()
 {
+    const TraceScope trace("DaemonClient::connect");
     disconnect();
 
     m_sockfd = socket(AF_UNIX, SOCK_DGRAM, 0);
@@ -47,7 +60,16 @@ void DaemonClient::connect()
         return;
     }
 
-    constexpr sockaddr_un saddr = {AF_UNIX, "/tmp/optimus-manager"};
+    sockaddr_un saddr = {};
+    saddr.sun_family = AF_UNIX;
+    const QByteArray socketPath = QFile::encodeName(SystemPaths::daemonSocket());
+    if (static_cast<size_t>(socketPath.size()) >= sizeof(saddr.sun_path)) {
+        errno = ENAMETOOLONG;
+        setError(true);
+        return;
+    }
+    std::memcpy(saddr.sun_path, socketPath.constData(), static_cast<size_t>(socketPath.size()));
+
     const int connectionStatus = ::connect(m_sockfd, reinterpret_cast<const sockaddr *>(&saddr), sizeof(saddr));
     setError(connectionStatus == -1);
 }
@@ -72,7 +94,10 @@ void DaemonClient::setGpu(OptimusSettings::Mode gpu)
 
 void DaemonClient::setConfig(const QString &content)
 {
-    sendCommand(QStringLiteral("user_config"), {{QStringLiteral("content"), content}});
+    if (s_configFdEnabled && sendConfigFd(content.toUtf8()))
+        return;
+
+    sendRawCommand(configCommand(content));
 }
 
 void DaemonClient::setTempConfig(const QString &path)
@@ -80,6 +105,19 @@ void DaemonClient::setTempConfig(const QString &path)
     sendCommand(QStringLiteral("temp_config"), {{QStringLiteral("path"), path}});
 }
 
+void DaemonClient::sendRawCommand(const QByteArray &command)
+{
+    const TraceScope trace("DaemonClient::sendRawCommand");
+    const bool succes = ::send(m_sockfd, command.data(), static_cast<size_t>(command.size()), 0) != -1;
+
+    setError(!succes);
+}
+
+QByteArray DaemonClient::configCommand(const QString &content)
+{
+    return command(QStringLiteral("user_config"), {{QStringLiteral("content"), content}});
+}
+
 bool DaemonClient::error() const
 {
     return m_error;
@@ -91,13 +129,71 @@ QString DaemonClient::errorString()
 }
 
 void DaemonClient::sendCommand(const QString &type, std::initializer_list<QPair<QString, QJsonValue>> args)
+{
+    const TraceScope trace("DaemonClient::sendCommand", type);
+    sendRawCommand(command(type, args));
+}
+
+QByteArray DaemonClient::command(const QString &type, std::initializer_list<QPair<QString, QJsonValue>> args)
 {
     const QJsonDocument command{{{QStringLiteral("type"), type}, {QStringLiteral("args"), {args}}}};
-    const QByteArray json = command.toJson();
+    return command.toJson(QJsonDocument::Compact);
+}
 
-    const bool succes = ::send(m_sockfd, json.data(), static_cast<size_t>(json.size()), 0) != -1;
+// Returns false if the descriptor cannot be sent, inline command is used then
+bool DaemonClient::sendConfigFd(const QByteArray &content)
+{
+    const TraceScope trace("DaemonClient::sendConfigFd");
+    const int fd = memfd_create("optimus-manager-config", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        qWarning("Unable to create memory file for configuration: %s", strerror(errno));
+        return false;
+    }
 
-    setError(!succes);
+    qint64 written = 0;
+    while (written < content.size()) {
+        const ssize_t result = write(fd, content.constData() + written, static_cast<size_t>(content.size() - written));
+        if (result == -1) {
+            if (errno == EINTR)
+                continue;
+            qWarning("Unable to write configuration to memory file: %s", strerror(errno));
+            close(fd);
+            return false;
+        }
+        written += result;
+    }
+
+    // Daemon can rely on the content not being changed after validation
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        qWarning("Unable to seal configuration memory file: %s", strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    QByteArray envelope = command(QStringLiteral("user_config_fd"), {{QStringLiteral("size"), content.size()}});
+    iovec payload = {envelope.data(), static_cast<size_t>(envelope.size())};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message = {};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr *controlMessage = CMSG_FIRSTHDR(&message);
+    controlMessage->cmsg_level = SOL_SOCKET;
+    controlMessage->cmsg_type = SCM_RIGHTS;
+    controlMessage->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(controlMessage), &fd, sizeof(int));
+
+    const bool succes = sendmsg(m_sockfd, &message, 0) != -1;
+    if (!succes)
+        qWarning("Unable to send configuration memory file: %s", strerror(errno));
+    close(fd);
+
+    if (succes)
+        setError(false);
+    return succes;
 }
 
 void DaemonClient::setError(bool error)
@@ -35,14 +35,22 @@ public:
     void disconnect();
 
     void setGpu(OptimusSettings::Mode gpu);
+    // Set OPTIMUS_MANAGER_QT_CONFIG_FD to pass content as a sealed memfd instead of inline JSON,
+    // requires daemon support for user_config_fd command.
     void setConfig(const QString &content);
     void setTempConfig(const QString &path);
 
+    // Sends a command prepared in advance with one of the static functions below
+    void sendRawCommand(const QByteArray &command);
+    static QByteArray configCommand(const QString &content);
+
     bool error() const;
     QString errorString();
 
 private:
     void sendCommand(const QString &type, std::initializer_list<QPair<QString, QJsonValue>> args);
+    bool sendConfigFd(const QByteArray &content);
+    static QByteArray command(const QString &type, std::initializer_list<QPair<QString, QJsonValue>> args);
     void setError(bool error);
 
     QString m_errorString;
@@ -0,0 +1,450 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "dbusmenuexporter.h"
+
+#include <QActionEvent>
+#include <QActionGroup>
+#include <QBuffer>
+#include <QDBusConnection>
+#include <QDBusMetaType>
+#include <QGuiApplication>
+#include <QMenu>
+#include <QTimer>
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuItem &item)
+{
+    argument.beginStructure();
+    argument << item.id << item.properties;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuItem &item)
+{
+    argument.beginStructure();
+    argument >> item.id >> item.properties;
+    argument.endStructure();
+    return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuItemKeys &keys)
+{
+    argument.beginStructure();
+    argument << keys.id << keys.properties;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuItemKeys &keys)
+{
+    argument.beginStructure();
+    argument >> keys.id >> keys.properties;
+    argument.endStructure();
+    return argument;
+}
+
+// Children are sent as variants
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuLayoutItem &item)
+{
+    argument.beginStructure();
+    argument << item.id << item.properties;
+    argument.beginArray(qMetaTypeId<QDBusVariant>());
+    for (const DBusMenuLayoutItem &child : item.children)
+        argument << QDBusVariant(QVariant::fromValue(child));
+    argument.endArray();
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuLayoutItem &item)
+{
+    argument.beginStructure();
+    argument >> item.id >> item.properties;
+    argument.beginArray();
+    item.children.clear();
+    while (!argument.atEnd()) {
+        QDBusVariant child;
+        argument >> child;
+        item.children.append(qdbus_cast<DBusMenuLayoutItem>(child.variant()));
+    }
+    argument.endArray();
+    argument.endStructure();
+    return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuEvent &event)
+{
+    argument.beginStructure();
+    argument << event.id << event.eventId << event.data << event.timestamp;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuEvent &event)
+{
+    argument.beginStructure();
+    argument >> event.id >> event.eventId >> event.data >> event.timestamp;
+    argument.endStructure();
+    return argument;
+}
+
+DBusMenuExporter::DBusMenuExporter(const QString &objectPath, QMenu *menu, QObject *parent)
+    : QObject(parent)
+    , m_menu(menu)
+    , m_updateTimer(new QTimer(this))
+{
+    qDBusRegisterMetaType<DBusMenuItem>();
+    qDBusRegisterMetaType<DBusMenuItemList>();
+    qDBusRegisterMetaType<DBusMenuItemKeys>();
+    qDBusRegisterMetaType<DBusMenuItemKeysList>();
+    qDBusRegisterMetaType<DBusMenuLayoutItem>();
+    qDBusRegisterMetaType<DBusMenuEvent>();
+    qDBusRegisterMetaType<DBusMenuEventList>();
+    qDBusRegisterMetaType<QList<int>>();
+
+    // Send all changes made in one event loop iteration at once
+    m_updateTimer->setSingleShot(true);
+    m_updateTimer->setInterval(0);
+    connect(m_updateTimer, &QTimer::timeout, this, &DBusMenuExporter::sendUpdates);
+
+    watchMenu(m_menu);
+
+    new DBusMenuAdaptor(this);
+    if (!QDBusConnection::sessionBus().registerObject(objectPath, this, QDBusConnection::ExportAdaptors))
+        qWarning("Unable to register D-Bus menu object %s", qPrintable(objectPath));
+}
+
+uint DBusMenuExporter::revision() const
+{
+    return m_revision;
+}
+
+DBusMenuLayoutItem DBusMenuExporter::layout(int parentId, int depth, const QStringList &propertyNames)
+{
+    DBusMenuLayoutItem item;
+    item.id = parentId;
+    if (parentId == 0) {
+        item.properties.insert(QStringLiteral("children-display"), QStringLiteral("submenu"));
+    } else if (QAction *action = m_actions.value(parentId); action != nullptr) {
+        item.properties = actionProperties(action, propertyNames);
+    }
+
+    QMenu *parentMenu = menu(parentId);
+    if (parentMenu == nullptr || depth == 0)
+        return item;
+
+    // Negative depth means all levels
+    for (QAction *action : parentMenu->actions()) {
+        if (QMenu *subMenu = action->menu(); subMenu != nullptr)
+            watchMenu(subMenu);
+        item.children.append(layout(actionId(action), depth - 1, propertyNames));
+    }
+
+    return item;
+}
+
+DBusMenuItemList DBusMenuExporter::groupProperties(const QList<int> &ids, const QStringList &propertyNames)
+{
+    DBusMenuItemList items;
+    for (int id : ids) {
+        if (QAction *action = m_actions.value(id); action != nullptr)
+            items.append(DBusMenuItem{id, actionProperties(action, propertyNames)});
+    }
+    return items;
+}
+
+QVariant DBusMenuExporter::itemProperty(int id, const QString &name)
+{
+    QAction *action = m_actions.value(id);
+    if (action == nullptr)
+        return {};
+
+    return actionProperties(action, {name}).value(name);
+}
+
+bool DBusMenuExporter::processEvent(int id, const QString &eventId)
+{
+    if (id == 0 || menu(id) != nullptr) {
+        if (eventId == QLatin1String("opened"))
+            return aboutToShow(id);
+        return true;
+    }
+
+    QAction *action = m_actions.value(id);
+    if (action == nullptr)
+        return false;
+
+    // Triggered action can open a modal dialog, so do not block D-Bus reply
+    if (eventId == QLatin1String("clicked") && action->isEnabled())
+        QMetaObject::invokeMethod(action, &QAction::trigger, Qt::QueuedConnection);
+
+    return true;
+}
+
+bool DBusMenuExporter::aboutToShow(int id)
+{
+    QMenu *shownMenu = menu(id);
+    if (shownMenu == nullptr)
+        return m_actions.contains(id);
+
+    emit shownMenu->aboutToShow();
+
+    // Deliver changes made by handlers before the menu is displayed
+    if (m_updateTimer->isActive()) {
+        m_updateTimer->stop();
+        sendUpdates();
+    }
+
+    return true;
+}
+
+bool DBusMenuExporter::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::ActionAdded:
+    case QEvent::ActionRemoved:
+        if (auto *changedMenu = qobject_cast<QMenu *>(watched); changedMenu != nullptr) {
+            m_changedLayouts.insert(changedMenu == m_menu ? 0 : actionId(changedMenu->menuAction()));
+            m_updateTimer->start();
+        }
+        break;
+    case QEvent::ActionChanged:
+        m_changedItems.insert(actionId(static_cast<QActionEvent *>(event)->action()));
+        m_updateTimer->start();
+        break;
+    default:
+        break;
+    }
+
+    return QObject::eventFilter(watched, event);
+}
+
+void DBusMenuExporter::sendUpdates()
+{
+    if (!m_changedLayouts.isEmpty()) {
+        ++m_revision;
+        for (int parentId : qAsConst(m_changedLayouts))
+            emit layoutUpdated(m_revision, parentId);
+        m_changedLayouts.clear();
+    }
+
+    if (m_changedItems.isEmpty())
+        return;
+
+    // Properties with default values are omitted, so report them as removed to reset on the host
+    const QStringList optionalProperties{QStringLiteral("type"), QStringLiteral("enabled"), QStringLiteral("visible"), QStringLiteral("icon-name"), QStringLiteral("icon-data"),
+                                         QStringLiteral("toggle-type"), QStringLiteral("toggle-state"), QStringLiteral("children-display")};
+    DBusMenuItemList updatedProperties;
+    DBusMenuItemKeysList removedProperties;
+    for (int id : qAsConst(m_changedItems)) {
+        QAction *action = m_actions.value(id);
+        if (action == nullptr)
+            continue;
+
+        const QVariantMap properties = actionProperties(action, {});
+        updatedProperties.append(DBusMenuItem{id, properties});
+
+        QStringList removedNames;
+        for (const QString &name : optionalProperties) {
+            if (!properties.contains(name))
+                removedNames.append(name);
+        }
+        if (!removedNames.isEmpty())
+            removedProperties.append(DBusMenuItemKeys{id, removedNames});
+    }
+    m_changedItems.clear();
+
+    emit itemsPropertiesUpdated(updatedProperties, removedProperties);
+}
+
+int DBusMenuExporter::actionId(QAction *action)
+{
+    if (auto it = m_ids.constFind(action); it != m_ids.constEnd())
+        return *it;
+
+    const int id = m_nextId++;
+    m_ids.insert(action, id);
+    m_actions.insert(id, action);
+    connect(action, &QObject::destroyed, this, [this, action, id] {
+        m_ids.remove(action);
+        m_actions.remove(id);
+    });
+    return id;
+}
+
+QMenu *DBusMenuExporter::menu(int id) const
+{
+    if (id == 0)
+        return m_menu;
+
+    QAction *action = m_actions.value(id);
+    return action != nullptr ? action->menu() : nullptr;
+}
+
+void DBusMenuExporter::watchMenu(QMenu *menu)
+{
+    // Installing the same filter again does not duplicate it
+    menu->installEventFilter(this);
+}
+
+QVariantMap DBusMenuExporter::actionProperties(QAction *action, const QStringList &propertyNames) const
+{
+    QVariantMap properties;
+    if (action->isSeparator()) {
+        properties.insert(QStringLiteral("type"), QStringLiteral("separator"));
+    } else {
+        properties.insert(QStringLiteral("label"), labelText(action->text()));
+
+        const QIcon icon = action->icon();
+        if (!icon.name().isEmpty()) {
+            properties.insert(QStringLiteral("icon-name"), icon.name());
+        } else if (!icon.isNull()) {
+            QByteArray iconData;
+            QBuffer iconBuffer(&iconData);
+            iconBuffer.open(QIODevice::WriteOnly);
+            icon.pixmap(16).save(&iconBuffer, "PNG");
+            properties.insert(QStringLiteral("icon-data"), iconData);
+        }
+
+        if (action->isCheckable()) {
+            const bool exclusive = action->actionGroup() != nullptr && action->actionGroup()->isExclusive();
+            properties.insert(QStringLiteral("toggle-type"), exclusive ? QStringLiteral("radio") : QStringLiteral("checkmark"));
+            properties.insert(QStringLiteral("toggle-state"), action->isChecked() ? 1 : 0);
+        }
+
+        if (action->menu() != nullptr)
+            properties.insert(QStringLiteral("children-display"), QStringLiteral("submenu"));
+    }
+
+    if (!action->isEnabled())
+        properties.insert(QStringLiteral("enabled"), false);
+    if (!action->isVisible())
+        properties.insert(QStringLiteral("visible"), false);
+
+    if (propertyNames.isEmpty())
+        return properties;
+
+    QVariantMap requestedProperties;
+    for (const QString &name : propertyNames) {
+        if (auto it = properties.constFind(name); it != properties.constEnd())
+            requestedProperties.insert(name, *it);
+    }
+    return requestedProperties;
+}
+
+// Convert Qt mnemonics to dbusmenu ones
+QString DBusMenuExporter::labelText(const QString &text)
+{
+    QString label;
+    label.reserve(text.size());
+    for (int i = 0; i < text.size(); ++i) {
+        const QChar character = text.at(i);
+        if (character == '_') {
+            label += QStringLiteral("__");
+        } else if (character == '&') {
+            if (i + 1 < text.size() && text.at(i + 1) == '&') {
+                label += '&';
+                ++i;
+            } else {
+                label += '_';
+            }
+        } else {
+            label += character;
+        }
+    }
+    return label;
+}
+
+DBusMenuAdaptor::DBusMenuAdaptor(DBusMenuExporter *exporter)
+    : QDBusAbstractAdaptor(exporter)
+    , m_exporter(exporter)
+{
+    connect(m_exporter, &DBusMenuExporter::layoutUpdated, this, &DBusMenuAdaptor::LayoutUpdated);
+    connect(m_exporter, &DBusMenuExporter::itemsPropertiesUpdated, this, &DBusMenuAdaptor::ItemsPropertiesUpdated);
+}
+
+uint DBusMenuAdaptor::version() const
+{
+    return 3;
+}
+
+QString DBusMenuAdaptor::textDirection() const
+{
+    return QGuiApplication::layoutDirection() == Qt::RightToLeft ? QStringLiteral("rtl") : QStringLiteral("ltr");
+}
+
+QString DBusMenuAdaptor::status() const
+{
+    return QStringLiteral("normal");
+}
+
+QStringList DBusMenuAdaptor::iconThemePath() const
+{
+    return {};
+}
+
+uint DBusMenuAdaptor::GetLayout(int parentId, int recursionDepth, const QStringList &propertyNames, DBusMenuLayoutItem &layout)
+{
+    layout = m_exporter->layout(parentId, recursionDepth, propertyNames);
+    return m_exporter->revision();
+}
+
+DBusMenuItemList DBusMenuAdaptor::GetGroupProperties(const QList<int> &ids, const QStringList &propertyNames)
+{
+    return m_exporter->groupProperties(ids, propertyNames);
+}
+
+QDBusVariant DBusMenuAdaptor::GetProperty(int id, const QString &name)
+{
+    return QDBusVariant(m_exporter->itemProperty(id, name));
+}
+
+void DBusMenuAdaptor::Event(int id, const QString &eventId, const QDBusVariant &data, uint timestamp)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(timestamp)
+    m_exporter->processEvent(id, eventId);
+}
+
+QList<int> DBusMenuAdaptor::EventGroup(const DBusMenuEventList &events)
+{
+    QList<int> idErrors;
+    for (const DBusMenuEvent &event : events) {
+        if (!m_exporter->processEvent(event.id, event.eventId))
+            idErrors.append(event.id);
+    }
+    return idErrors;
+}
+
+// Updates are sent with signals before returning, so hosts never need to request them
+bool DBusMenuAdaptor::AboutToShow(int id)
+{
+    m_exporter->aboutToShow(id);
+    return false;
+}
+
+QList<int> DBusMenuAdaptor::AboutToShowGroup(const QList<int> &ids, QList<int> &idErrors)
+{
+    for (int id : ids) {
+        if (!m_exporter->aboutToShow(id))
+            idErrors.append(id);
+    }
+    return {};
+}
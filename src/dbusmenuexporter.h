@@ -0,0 +1,160 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DBUSMENUEXPORTER_H
+#define DBUSMENUEXPORTER_H
+
+#include <QDBusAbstractAdaptor>
+#include <QDBusArgument>
+#include <QDBusVariant>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+
+class QAction;
+class QMenu;
+class QTimer;
+
+// Structures of com.canonical.dbusmenu protocol
+struct DBusMenuItem {
+    int id = 0;
+    QVariantMap properties;
+};
+using DBusMenuItemList = QList<DBusMenuItem>;
+
+struct DBusMenuItemKeys {
+    int id = 0;
+    QStringList properties;
+};
+using DBusMenuItemKeysList = QList<DBusMenuItemKeys>;
+
+struct DBusMenuLayoutItem {
+    int id = 0;
+    QVariantMap properties;
+    QList<DBusMenuLayoutItem> children;
+};
+
+struct DBusMenuEvent {
+    int id = 0;
+    QString eventId;
+    QDBusVariant data;
+    uint timestamp = 0;
+};
+using DBusMenuEventList = QList<DBusMenuEvent>;
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuItem &item);
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuItem &item);
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuItemKeys &keys);
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuItemKeys &keys);
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuLayoutItem &item);
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuLayoutItem &item);
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusMenuEvent &event);
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusMenuEvent &event);
+
+Q_DECLARE_METATYPE(DBusMenuItem)
+Q_DECLARE_METATYPE(DBusMenuItemList)
+Q_DECLARE_METATYPE(DBusMenuItemKeys)
+Q_DECLARE_METATYPE(DBusMenuItemKeysList)
+Q_DECLARE_METATYPE(DBusMenuLayoutItem)
+Q_DECLARE_METATYPE(DBusMenuEvent)
+Q_DECLARE_METATYPE(DBusMenuEventList)
+
+// Exports QMenu with its submenus to StatusNotifierItem hosts.
+// Action and menu changes are coalesced and sent as ItemsPropertiesUpdated and LayoutUpdated of changed parts only.
+class DBusMenuExporter : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DBusMenuExporter)
+
+public:
+    DBusMenuExporter(const QString &objectPath, QMenu *menu, QObject *parent = nullptr);
+
+    uint revision() const;
+    DBusMenuLayoutItem layout(int parentId, int depth, const QStringList &propertyNames);
+    DBusMenuItemList groupProperties(const QList<int> &ids, const QStringList &propertyNames);
+    QVariant itemProperty(int id, const QString &name);
+    // Return false if there is no item with such id
+    bool processEvent(int id, const QString &eventId);
+    bool aboutToShow(int id);
+
+signals:
+    void layoutUpdated(uint revision, int parentId);
+    void itemsPropertiesUpdated(const DBusMenuItemList &updatedProperties, const DBusMenuItemKeysList &removedProperties);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void sendUpdates();
+
+private:
+    int actionId(QAction *action);
+    QMenu *menu(int id) const;
+    void watchMenu(QMenu *menu);
+    QVariantMap actionProperties(QAction *action, const QStringList &propertyNames) const;
+
+    static QString labelText(const QString &text);
+
+    QMenu *m_menu;
+    QTimer *m_updateTimer;
+    QHash<QAction *, int> m_ids;
+    QHash<int, QPointer<QAction>> m_actions;
+    QSet<int> m_changedItems;
+    QSet<int> m_changedLayouts;
+    int m_nextId = 1;
+    uint m_revision = 1;
+};
+
+class DBusMenuAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.canonical.dbusmenu")
+    Q_PROPERTY(uint Version READ version)
+    Q_PROPERTY(QString TextDirection READ textDirection)
+    Q_PROPERTY(QString Status READ status)
+    Q_PROPERTY(QStringList IconThemePath READ iconThemePath)
+    Q_DISABLE_COPY(DBusMenuAdaptor)
+
+public:
+    explicit DBusMenuAdaptor(DBusMenuExporter *exporter);
+
+    uint version() const;
+    QString textDirection() const;
+    QString status() const;
+    QStringList iconThemePath() const;
+
+public slots:
+    uint GetLayout(int parentId, int recursionDepth, const QStringList &propertyNames, DBusMenuLayoutItem &layout);
+    DBusMenuItemList GetGroupProperties(const QList<int> &ids, const QStringList &propertyNames);
+    QDBusVariant GetProperty(int id, const QString &name);
+    void Event(int id, const QString &eventId, const QDBusVariant &data, uint timestamp);
+    QList<int> EventGroup(const DBusMenuEventList &events);
+    bool AboutToShow(int id);
+    QList<int> AboutToShowGroup(const QList<int> &ids, QList<int> &idErrors);
+
+signals:
+    void ItemsPropertiesUpdated(const DBusMenuItemList &updatedProps, const DBusMenuItemKeysList &removedProps);
+    void LayoutUpdated(uint revision, int parent);
+    void ItemActivationRequested(int id, uint timestamp);
+
+private:
+    DBusMenuExporter *m_exporter;
+};
+
+#endif // DBUSMENUEXPORTER_H
@@ -0,0 +1,629 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "desktopcatalog.h"
+
+#include "tracescope.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLocale>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <algorithm>
+#include <string_view>
+
+namespace
+{
+constexpr quint32 s_indexMagic = 0x4f4d4445; // "OMDE", also rejects indexes with foreign byte order
+constexpr quint32 s_indexVersion = 1;
+constexpr int s_refreshDelay = 500;
+
+// Index layout: header, directories, entries, search keys sorted bytewise, UTF-8 strings.
+// Records are read in place from the mapping, so they contain only fixed-size fields.
+struct StringRef {
+    quint32 offset;
+    quint32 length;
+};
+
+struct IndexHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 directoryCount;
+    quint32 entryCount;
+    quint32 keyCount;
+    quint32 stringsSize;
+    StringRef locale;
+};
+
+struct DirectoryRecord {
+    qint64 modificationTime;
+    StringRef path;
+};
+
+struct EntryRecord {
+    quint32 directory;
+    quint32 hidden;
+    StringRef id;
+    StringRef name;
+    StringRef exec;
+    StringRef icon;
+};
+
+struct KeyRecord {
+    StringRef key; // Case folded
+    quint32 entry;
+};
+
+static_assert(sizeof(IndexHeader) % alignof(DirectoryRecord) == 0 && sizeof(DirectoryRecord) % alignof(EntryRecord) == 0, "Records must stay aligned");
+
+class IndexView
+{
+public:
+    IndexView(const uchar *data, qint64 size)
+    {
+        if (data == nullptr || size < static_cast<qint64>(sizeof(IndexHeader)))
+            return;
+
+        const auto *header = reinterpret_cast<const IndexHeader *>(data);
+        if (header->magic != s_indexMagic || header->version != s_indexVersion)
+            return;
+
+        const qint64 stringsOffset = static_cast<qint64>(sizeof(IndexHeader)) + static_cast<qint64>(header->directoryCount) * sizeof(DirectoryRecord)
+            + static_cast<qint64>(header->entryCount) * sizeof(EntryRecord) + static_cast<qint64>(header->keyCount) * sizeof(KeyRecord);
+        if (stringsOffset + header->stringsSize != size)
+            return;
+
+        m_header = header;
+        m_directories = reinterpret_cast<const DirectoryRecord *>(data + sizeof(IndexHeader));
+        m_entries = reinterpret_cast<const EntryRecord *>(m_directories + header->directoryCount);
+        m_keys = reinterpret_cast<const KeyRecord *>(m_entries + header->entryCount);
+        m_strings = reinterpret_cast<const char *>(m_keys + header->keyCount);
+    }
+
+    bool isValid() const
+    {
+        return m_header != nullptr;
+    }
+
+    const IndexHeader &header() const
+    {
+        return *m_header;
+    }
+
+    const DirectoryRecord &directory(quint32 index) const
+    {
+        return m_directories[index];
+    }
+
+    const EntryRecord &entry(quint32 index) const
+    {
+        return m_entries[index];
+    }
+
+    const KeyRecord *keysBegin() const
+    {
+        return m_keys;
+    }
+
+    const KeyRecord *keysEnd() const
+    {
+        return m_keys + m_header->keyCount;
+    }
+
+    std::string_view string(StringRef ref) const
+    {
+        if (static_cast<qint64>(ref.offset) + ref.length > m_header->stringsSize)
+            return {};
+
+        return {m_strings + ref.offset, ref.length};
+    }
+
+    QString text(StringRef ref) const
+    {
+        const std::string_view view = string(ref);
+        return QString::fromUtf8(view.data(), static_cast<int>(view.size()));
+    }
+
+private:
+    const IndexHeader *m_header = nullptr;
+    const DirectoryRecord *m_directories = nullptr;
+    const EntryRecord *m_entries = nullptr;
+    const KeyRecord *m_keys = nullptr;
+    const char *m_strings = nullptr;
+};
+
+std::string_view stringView(const QByteArray &strings, StringRef ref)
+{
+    return {strings.constData() + ref.offset, ref.length};
+}
+
+// Only string-level escapes, quoting in Exec is left for the shell
+QString unescapeValue(const QString &value)
+{
+    QString result;
+    result.reserve(value.size());
+    for (int i = 0; i < value.size(); ++i) {
+        if (value.at(i) != '\\' || i + 1 == value.size()) {
+            result.append(value.at(i));
+            continue;
+        }
+
+        switch (value.at(++i).unicode()) {
+        case 's':
+            result.append(' ');
+            break;
+        case 'n':
+            result.append('\n');
+            break;
+        case 't':
+            result.append('\t');
+            break;
+        case 'r':
+            result.append('\r');
+            break;
+        default:
+            result.append(value.at(i));
+        }
+    }
+    return result;
+}
+
+// Files and URLs are not passed, so all field codes are dropped
+QString removeFieldCodes(const QString &exec)
+{
+    QString result;
+    result.reserve(exec.size());
+    for (int i = 0; i < exec.size(); ++i) {
+        if (exec.at(i) != '%') {
+            result.append(exec.at(i));
+            continue;
+        }
+
+        if (i + 1 < exec.size() && exec.at(i + 1) == '%')
+            result.append('%');
+        ++i;
+    }
+    return result.trimmed();
+}
+
+// Full name, every word with the rest of the name and the executable name
+QStringList searchKeys(const DesktopCatalog::Entry &entry)
+{
+    const QString name = entry.name.toCaseFolded();
+    QStringList keys{name};
+    for (int i = 1; i < name.size(); ++i) {
+        if ((name.at(i - 1).isSpace() || name.at(i - 1) == '-') && !name.at(i).isSpace())
+            keys.append(name.mid(i));
+    }
+
+    const QString program = QFileInfo(entry.exec.section(' ', 0, 0)).fileName().toCaseFolded();
+    if (!program.isEmpty())
+        keys.append(program);
+
+    keys.removeDuplicates();
+    return keys;
+}
+}
+
+class DesktopCatalog::DirectoryScan : public QRunnable
+{
+public:
+    DirectoryScan(DesktopCatalog *catalog, int generation, int directoryIndex, const QString &path, const QString &locale)
+        : m_catalog(catalog)
+        , m_generation(generation)
+        , m_directoryIndex(directoryIndex)
+        , m_path(path)
+        , m_localeKey("Name[" + locale.toUtf8() + ']')
+        , m_languageKey("Name[" + locale.section('_', 0, 0).toUtf8() + ']')
+    {
+    }
+
+    void run() override
+    {
+        const TraceScope trace("DesktopCatalog::DirectoryScan", m_path);
+
+        // IDs of entries in subdirectories include the subdirectory name
+        QVector<ScannedEntry> entries;
+        const QDir directory(m_path);
+        QDirIterator it(m_path, {QStringLiteral("*.desktop")}, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString path = it.next();
+            ScannedEntry scannedEntry;
+            scannedEntry.entry.id = directory.relativeFilePath(path).replace('/', '-');
+            if (parse(path, scannedEntry))
+                entries.append(scannedEntry);
+        }
+
+        DesktopCatalog *catalog = m_catalog;
+        QMetaObject::invokeMethod(
+            catalog, [catalog, generation = m_generation, directoryIndex = m_directoryIndex, entries] { catalog->finishScan(generation, directoryIndex, entries); }, Qt::QueuedConnection);
+    }
+
+private:
+    // Reads only the main group, localized name is taken for the full locale or its language
+    bool parse(const QString &path, ScannedEntry &scannedEntry) const
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        bool inMainGroup = false;
+        bool mainGroupFound = false;
+        bool isApplication = false;
+        QString localizedName;
+        bool exactLocale = false;
+        while (!file.atEnd()) {
+            const QByteArray line = file.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith('#'))
+                continue;
+
+            if (line.startsWith('[')) {
+                if (mainGroupFound)
+                    break;
+                inMainGroup = line == "[Desktop Entry]";
+                mainGroupFound = inMainGroup;
+                continue;
+            }
+
+            const int separator = line.indexOf('=');
+            if (!inMainGroup || separator == -1)
+                continue;
+
+            const QByteArray key = line.left(separator).trimmed();
+            const QString value = unescapeValue(QString::fromUtf8(line.mid(separator + 1).trimmed()));
+            if (key == "Type") {
+                isApplication = value == QLatin1String("Application");
+            } else if (key == "Name") {
+                scannedEntry.entry.name = value;
+            } else if (key == m_localeKey) {
+                localizedName = value;
+                exactLocale = true;
+            } else if (key == m_languageKey && !exactLocale) {
+                localizedName = value;
+            } else if (key == "Exec") {
+                scannedEntry.entry.exec = removeFieldCodes(value);
+            } else if (key == "Icon") {
+                scannedEntry.entry.icon = value;
+            } else if (key == "NoDisplay" || key == "Hidden") {
+                scannedEntry.hidden = scannedEntry.hidden || value == QLatin1String("true");
+            }
+        }
+
+        if (!mainGroupFound)
+            return false;
+
+        if (!localizedName.isEmpty())
+            scannedEntry.entry.name = localizedName;
+        if (!isApplication || scannedEntry.entry.name.isEmpty() || scannedEntry.entry.exec.isEmpty())
+            scannedEntry.hidden = true;
+
+        return true;
+    }
+
+    DesktopCatalog *m_catalog;
+    const int m_generation;
+    const int m_directoryIndex;
+    const QString m_path;
+    const QByteArray m_localeKey;
+    const QByteArray m_languageKey;
+};
+
+DesktopCatalog *DesktopCatalog::s_instance = nullptr;
+
+DesktopCatalog::DesktopCatalog(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_refreshTimer(new QTimer(this))
+    , m_watcher(new QFileSystemWatcher(this))
+{
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(s_refreshDelay);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DesktopCatalog::refresh);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &DesktopCatalog::onDirectoryChanged);
+
+    // Previous index is searchable right away, outdated directories are parsed in background
+    mapIndex();
+    refresh();
+}
+
+DesktopCatalog::~DesktopCatalog()
+{
+    m_pool->clear();
+    m_pool->waitForDone();
+    unmapIndex();
+    s_instance = nullptr;
+}
+
+DesktopCatalog *DesktopCatalog::instance()
+{
+    if (s_instance == nullptr)
+        s_instance = new DesktopCatalog(QCoreApplication::instance());
+
+    return s_instance;
+}
+
+QVector<DesktopCatalog::Entry> DesktopCatalog::search(const QString &prefix) const
+{
+    const IndexView index(m_index, m_indexSize);
+    if (!index.isValid())
+        return {};
+
+    const QByteArray foldedPrefix = prefix.toCaseFolded().toUtf8();
+    const std::string_view prefixView(foldedPrefix.constData(), static_cast<size_t>(foldedPrefix.size()));
+    const KeyRecord *first = std::lower_bound(index.keysBegin(), index.keysEnd(), prefixView, [&index](const KeyRecord &record, std::string_view key) {
+        return index.string(record.key) < key;
+    });
+
+    // Several keys of an entry can start with the prefix
+    QVector<quint32> entryIndexes;
+    QSet<quint32> foundIndexes;
+    for (const KeyRecord *record = first; record != index.keysEnd() && index.string(record->key).substr(0, prefixView.size()) == prefixView; ++record) {
+        if (record->entry < index.header().entryCount && !foundIndexes.contains(record->entry)) {
+            foundIndexes.insert(record->entry);
+            entryIndexes.append(record->entry);
+        }
+    }
+
+    QVector<Entry> entries;
+    entries.reserve(entryIndexes.size());
+    for (quint32 entryIndex : qAsConst(entryIndexes)) {
+        const EntryRecord &record = index.entry(entryIndex);
+        entries.append({index.text(record.id), index.text(record.name), index.text(record.exec), index.text(record.icon)});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &first, const Entry &second) {
+        return QString::compare(first.name, second.name, Qt::CaseInsensitive) < 0;
+    });
+
+    return entries;
+}
+
+QStringList DesktopCatalog::directories()
+{
+    QStringList paths = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+
+    // Exports are usually listed in XDG_DATA_DIRS, but not in sessions started without Flatpak profile scripts
+    const QString userExports = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/flatpak/exports/share/applications");
+    paths << userExports << QStringLiteral("/var/lib/flatpak/exports/share/applications");
+
+    paths.removeDuplicates();
+    return paths;
+}
+
+void DesktopCatalog::refresh()
+{
+    const TraceScope trace("DesktopCatalog::refresh");
+    const QStringList paths = directories();
+    const IndexView index(m_index, m_indexSize);
+
+    // Queued scans of the replaced refresh are not needed, running ones are dropped by generation
+    m_pool->clear();
+    ++m_generation;
+    m_pendingScans = 0;
+    m_locale = QLocale().name();
+    m_indexOutdated = !index.isValid() || index.header().directoryCount != static_cast<quint32>(paths.size());
+
+    const QStringList watchedDirectories = m_watcher->directories();
+    m_directories.clear();
+    m_directories.resize(paths.size());
+    for (int i = 0; i < paths.size(); ++i) {
+        ScannedDirectory &directory = m_directories[i];
+        directory.path = paths.at(i);
+
+        // Missing directories are not watched and picked up on the next start
+        QStringList subdirectories;
+        directory.modificationTime = modificationTime(directory.path, subdirectories);
+        if (directory.modificationTime != -1) {
+            subdirectories.prepend(directory.path);
+            for (const QString &subdirectory : qAsConst(subdirectories)) {
+                if (!watchedDirectories.contains(subdirectory))
+                    m_watcher->addPath(subdirectory);
+            }
+        }
+
+        if (!m_changedDirectories.contains(directory.path) && readCachedDirectory(directory))
+            continue;
+
+        m_indexOutdated = true;
+        if (directory.modificationTime != -1) {
+            ++m_pendingScans;
+            m_pool->start(new DirectoryScan(this, m_generation, i, directory.path, m_locale));
+        }
+    }
+    m_changedDirectories.clear();
+
+    if (m_pendingScans == 0 && m_indexOutdated)
+        writeIndex();
+}
+
+void DesktopCatalog::onDirectoryChanged(const QString &path)
+{
+    for (const ScannedDirectory &directory : qAsConst(m_directories)) {
+        if (path == directory.path || path.startsWith(directory.path + '/')) {
+            m_changedDirectories.insert(directory.path);
+            break;
+        }
+    }
+
+    // Package managers change many files at once
+    m_refreshTimer->start();
+}
+
+void DesktopCatalog::mapIndex()
+{
+    m_indexFile.setFileName(indexPath());
+    if (!m_indexFile.open(QIODevice::ReadOnly))
+        return; // Not created yet
+
+    m_indexSize = m_indexFile.size();
+    m_index = m_indexFile.map(0, m_indexSize);
+    if (m_index == nullptr) {
+        qWarning("Unable to map desktop entries index %s: %s", qPrintable(m_indexFile.fileName()), qPrintable(m_indexFile.errorString()));
+        m_indexSize = 0;
+        m_indexFile.close();
+    }
+}
+
+void DesktopCatalog::unmapIndex()
+{
+    if (m_index != nullptr)
+        m_indexFile.unmap(const_cast<uchar *>(m_index));
+    m_index = nullptr;
+    m_indexSize = 0;
+    m_indexFile.close();
+}
+
+bool DesktopCatalog::readCachedDirectory(ScannedDirectory &directory) const
+{
+    const IndexView index(m_index, m_indexSize);
+    if (!index.isValid() || index.text(index.header().locale) != m_locale)
+        return false;
+
+    for (quint32 i = 0; i < index.header().directoryCount; ++i) {
+        const DirectoryRecord &directoryRecord = index.directory(i);
+        if (index.text(directoryRecord.path) != directory.path)
+            continue;
+
+        if (directoryRecord.modificationTime != directory.modificationTime)
+            return false;
+
+        for (quint32 j = 0; j < index.header().entryCount; ++j) {
+            const EntryRecord &record = index.entry(j);
+            if (record.directory == i)
+                directory.entries.append({{index.text(record.id), index.text(record.name), index.text(record.exec), index.text(record.icon)}, record.hidden != 0});
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void DesktopCatalog::finishScan(int generation, int directoryIndex, const QVector<ScannedEntry> &entries)
+{
+    if (generation != m_generation)
+        return;
+
+    m_directories[directoryIndex].entries = entries;
+    if (--m_pendingScans == 0)
+        writeIndex();
+}
+
+void DesktopCatalog::writeIndex()
+{
+    const TraceScope trace("DesktopCatalog::writeIndex");
+
+    QByteArray strings;
+    const auto addString = [&strings](const QString &text) {
+        const QByteArray utf8 = text.toUtf8();
+        const StringRef ref = {static_cast<quint32>(strings.size()), static_cast<quint32>(utf8.size())};
+        strings.append(utf8);
+        return ref;
+    };
+
+    IndexHeader header = {};
+    header.magic = s_indexMagic;
+    header.version = s_indexVersion;
+    header.locale = addString(m_locale);
+
+    // Entries of all directories are stored for incremental updates, but only the first one with an ID is searchable
+    QVector<DirectoryRecord> directoryRecords;
+    QVector<EntryRecord> entryRecords;
+    QVector<KeyRecord> keyRecords;
+    QSet<QString> ids;
+    for (int i = 0; i < m_directories.size(); ++i) {
+        const ScannedDirectory &directory = m_directories.at(i);
+        directoryRecords.append({directory.modificationTime, addString(directory.path)});
+        for (const ScannedEntry &scannedEntry : directory.entries) {
+            const Entry &entry = scannedEntry.entry;
+            const auto entryIndex = static_cast<quint32>(entryRecords.size());
+            entryRecords.append({static_cast<quint32>(i), scannedEntry.hidden, addString(entry.id), addString(entry.name), addString(entry.exec), addString(entry.icon)});
+
+            if (ids.contains(entry.id))
+                continue;
+            ids.insert(entry.id);
+
+            if (!scannedEntry.hidden) {
+                for (const QString &key : searchKeys(entry))
+                    keyRecords.append({addString(key), entryIndex});
+            }
+        }
+    }
+    std::sort(keyRecords.begin(), keyRecords.end(), [&strings](const KeyRecord &first, const KeyRecord &second) {
+        return stringView(strings, first.key) < stringView(strings, second.key);
+    });
+
+    header.directoryCount = static_cast<quint32>(directoryRecords.size());
+    header.entryCount = static_cast<quint32>(entryRecords.size());
+    header.keyCount = static_cast<quint32>(keyRecords.size());
+    header.stringsSize = static_cast<quint32>(strings.size());
+
+    const QString path = indexPath();
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Unable to open desktop entries index %s: %s", qPrintable(path), qPrintable(file.errorString()));
+        return;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(directoryRecords.constData()), directoryRecords.size() * static_cast<qint64>(sizeof(DirectoryRecord)));
+    file.write(reinterpret_cast<const char *>(entryRecords.constData()), entryRecords.size() * static_cast<qint64>(sizeof(EntryRecord)));
+    file.write(reinterpret_cast<const char *>(keyRecords.constData()), keyRecords.size() * static_cast<qint64>(sizeof(KeyRecord)));
+    file.write(strings);
+    if (!file.commit()) {
+        qWarning("Unable to write desktop entries index %s: %s", qPrintable(path), qPrintable(file.errorString()));
+        return;
+    }
+
+    // Replaced file stays mapped until it is unmapped
+    unmapIndex();
+    mapIndex();
+    m_indexOutdated = false;
+    emit changed();
+}
+
+QString DesktopCatalog::indexPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/desktop-entries.index");
+}
+
+// Adding, removing or renaming files changes time of their directory
+qint64 DesktopCatalog::modificationTime(const QString &path, QStringList &subdirectories)
+{
+    const QFileInfo info(path);
+    if (!info.isDir())
+        return -1;
+
+    qint64 time = info.lastModified().toMSecsSinceEpoch();
+    QDirIterator it(path, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        subdirectories.append(it.next());
+        time = std::max(time, it.fileInfo().lastModified().toMSecsSinceEpoch());
+    }
+    return time;
+}
@@ -0,0 +1,107 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESKTOPCATALOG_H
+#define DESKTOPCATALOG_H
+
+#include <QFile>
+#include <QSet>
+#include <QVector>
+
+class QFileSystemWatcher;
+class QThreadPool;
+class QTimer;
+
+// Installed applications from desktop entries.
+// Parsed entries are kept in a memory-mapped index keyed on directory modification times,
+// only changed directories are parsed again, in parallel and off the GUI thread.
+class DesktopCatalog : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DesktopCatalog)
+
+public:
+    struct Entry {
+        QString id;
+        QString name;
+        QString exec; // Without field codes
+        QString icon;
+    };
+
+    ~DesktopCatalog() override;
+
+    static DesktopCatalog *instance();
+
+    // Case-insensitive prefix of the name, any word of it or the executable name, sorted by name.
+    // Empty prefix returns all applications.
+    QVector<Entry> search(const QString &prefix) const;
+
+    // Ordered by precedence, entries with the same ID in later directories are ignored
+    static QStringList directories();
+
+signals:
+    void changed();
+
+private slots:
+    void refresh();
+    void onDirectoryChanged(const QString &path);
+
+private:
+    class DirectoryScan;
+
+    struct ScannedEntry {
+        Entry entry;
+        bool hidden = false; // Still masks entries with the same ID
+    };
+
+    struct ScannedDirectory {
+        QString path;
+        qint64 modificationTime = -1;
+        QVector<ScannedEntry> entries;
+    };
+
+    explicit DesktopCatalog(QObject *parent = nullptr);
+
+    void mapIndex();
+    void unmapIndex();
+    bool readCachedDirectory(ScannedDirectory &directory) const;
+    void finishScan(int generation, int directoryIndex, const QVector<ScannedEntry> &entries);
+    void writeIndex();
+
+    static QString indexPath();
+    static qint64 modificationTime(const QString &path, QStringList &subdirectories);
+
+    static DesktopCatalog *s_instance;
+
+    QThreadPool *m_pool;
+    QTimer *m_refreshTimer;
+    QFileSystemWatcher *m_watcher;
+    QFile m_indexFile;
+    const uchar *m_index = nullptr;
+    qint64 m_indexSize = 0;
+
+    QString m_locale; // Localized names are stored, so the index is rebuilt when it changes
+    QVector<ScannedDirectory> m_directories;
+    QSet<QString> m_changedDirectories; // Reported by the watcher, file edits do not change directory time
+    int m_pendingScans = 0;
+    int m_generation = 0; // Drops results of replaced refreshes
+    bool m_indexOutdated = false;
+};
+
+#endif // DESKTOPCATALOG_H
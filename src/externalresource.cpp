@@ -0,0 +1,60 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "externalresource.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QIcon>
+#include <QResource>
+#include <QStandardPaths>
+
+ExternalResource::ExternalResource(const QString &fileName, Content content)
+    : m_content(content)
+{
+    // Also search next to the executable to run from build directory
+    m_path = QStandardPaths::locate(QStandardPaths::AppDataLocation, fileName);
+    if (m_path.isEmpty())
+        m_path = QDir(QCoreApplication::applicationDirPath()).filePath(fileName);
+
+    if (!QResource::registerResource(m_path)) {
+        qWarning("Unable to register resource file %s", qPrintable(m_path));
+        m_path.clear();
+        return;
+    }
+
+    if (m_content == IconTheme)
+        refreshIconThemes();
+}
+
+ExternalResource::~ExternalResource()
+{
+    if (m_path.isEmpty())
+        return;
+
+    QResource::unregisterResource(m_path);
+    if (m_content == IconTheme)
+        refreshIconThemes();
+}
+
+// Setting search paths resets theme directories that icon loader has already scanned
+void ExternalResource::refreshIconThemes()
+{
+    QIcon::setThemeSearchPaths(QIcon::themeSearchPaths());
+}
@@ -0,0 +1,46 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXTERNALRESOURCE_H
+#define EXTERNALRESOURCE_H
+
+#include <QString>
+
+// Registers binary resource file from application data directory while the object is alive
+class ExternalResource
+{
+    Q_DISABLE_COPY(ExternalResource)
+
+public:
+    enum Content {
+        Files,
+        IconTheme // Cached icon theme directories are rescanned on registration changes
+    };
+
+    explicit ExternalResource(const QString &fileName, Content content = Files);
+    ~ExternalResource();
+
+private:
+    static void refreshIconThemes();
+
+    QString m_path;
+    Content m_content;
+};
+
+#endif // EXTERNALRESOURCE_H
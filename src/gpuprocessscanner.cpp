@@ -0,0 +1,253 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "gpuprocessscanner.h"
+
+#include "gputopology.h"
+#include "systempaths.h"
+#include "tracescope.h"
+
+#include <QFile>
+#include <QSet>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iterator>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+// Not exposed by glibc headers
+struct linux_dirent64 {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[256];
+};
+
+constexpr size_t s_entriesBufferSize = 16384;
+
+// Prefixes of process names (truncated to 15 characters by the kernel) that belong to the desktop session
+constexpr const char *s_sessionProcesses[] = {
+    "Xorg",
+    "Xwayland",
+    "kwin",
+    "plasmashell",
+    "ksmserver",
+    "startplasma",
+    "gnome-shell",
+    "gnome-session",
+    "mutter",
+    "xdg-desktop-por",
+    "cinnamon",
+    "muffin",
+    "budgie-wm",
+    "marco",
+    "xfwm4",
+    "sway",
+    "Hyprland",
+    "weston",
+    "gamescope",
+};
+
+pid_t parsePid(const char *name)
+{
+    pid_t pid = 0;
+    for (; *name != '\0'; ++name) {
+        if (*name < '0' || *name > '9')
+            return -1;
+        pid = pid * 10 + (*name - '0');
+    }
+
+    return pid;
+}
+
+bool matchesNode(const char *link, ssize_t linkSize, const QByteArrayList &deviceNodes)
+{
+    for (const QByteArray &node : deviceNodes) {
+        if (node.endsWith('*')) {
+            const int prefixSize = node.size() - 1;
+            if (linkSize >= prefixSize && std::memcmp(link, node.constData(), static_cast<size_t>(prefixSize)) == 0)
+                return true;
+        } else if (linkSize == node.size() && std::memcmp(link, node.constData(), static_cast<size_t>(linkSize)) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isUsingDevice(int procFd, const char *pidName, const QByteArrayList &deviceNodes)
+{
+    char fdDirPath[32];
+    std::snprintf(fdDirPath, sizeof(fdDirPath), "%s/fd", pidName);
+
+    // Fails with EACCES for processes of other users
+    const int fdDirFd = openat(procFd, fdDirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fdDirFd == -1)
+        return false;
+
+    alignas(linux_dirent64) char entries[s_entriesBufferSize];
+    char link[64];
+    bool found = false;
+    while (!found) {
+        const long size = syscall(SYS_getdents64, fdDirFd, entries, sizeof(entries));
+        if (size <= 0)
+            break;
+
+        for (long offset = 0; offset < size && !found;) {
+            const auto *entry = reinterpret_cast<const linux_dirent64 *>(entries + offset);
+            offset += entry->d_reclen;
+            if (entry->d_name[0] == '.')
+                continue;
+
+            const ssize_t linkSize = readlinkat(fdDirFd, entry->d_name, link, sizeof(link));
+            found = linkSize > 0 && matchesNode(link, linkSize, deviceNodes);
+        }
+    }
+
+    close(fdDirFd);
+    return found;
+}
+
+QString processName(int procFd, const char *pidName)
+{
+    char commPath[32];
+    std::snprintf(commPath, sizeof(commPath), "%s/comm", pidName);
+
+    const int commFd = openat(procFd, commPath, O_RDONLY | O_CLOEXEC);
+    if (commFd == -1)
+        return {};
+
+    char name[32];
+    const ssize_t size = read(commFd, name, sizeof(name));
+    close(commFd);
+    if (size <= 0)
+        return {};
+
+    return QString::fromLocal8Bit(name, static_cast<int>(size)).trimmed();
+}
+
+// Returns -1 if the process does not exist
+pid_t parentPid(pid_t pid)
+{
+    QFile statFile(SystemPaths::procDir() + QStringLiteral("/%1/stat").arg(pid));
+    if (!statFile.open(QIODevice::ReadOnly))
+        return -1;
+
+    // Name can contain spaces and parentheses, so fields are counted after the last one
+    const QByteArray stat = statFile.readAll();
+    return stat.mid(stat.lastIndexOf(')') + 2).split(' ').value(1).toInt();
+}
+
+bool isSessionProcess(const QString &name)
+{
+    if (name == QLatin1String("X"))
+        return true;
+
+    return std::any_of(std::cbegin(s_sessionProcesses), std::cend(s_sessionProcesses), [&name](const char *sessionProcess) {
+        return name.startsWith(QLatin1String(sessionProcess));
+    });
+}
+}
+
+QByteArrayList GpuProcessScanner::discreteGpuNodes(const GpuDevice *gpu)
+{
+    if (gpu == nullptr)
+        return {};
+
+    QByteArrayList nodes;
+    if (gpu->vendor == GpuDevice::Nvidia)
+        nodes.append(QByteArrayLiteral("/dev/nvidia*"));
+    for (const QString &drmNode : gpu->drmNodes) {
+        if (drmNode.contains(QLatin1String("/renderD")))
+            nodes.append(QFile::encodeName(drmNode));
+    }
+
+    return nodes;
+}
+
+QVector<GpuProcess> GpuProcessScanner::processesUsing(const QByteArrayList &deviceNodes)
+{
+    const TraceScope trace("GpuProcessScanner::processesUsing");
+
+    QVector<GpuProcess> processes;
+    if (deviceNodes.isEmpty())
+        return processes;
+
+    const int procFd = open(QFile::encodeName(SystemPaths::procDir()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procFd == -1)
+        return processes;
+
+    const pid_t ownPid = getpid();
+    alignas(linux_dirent64) char entries[s_entriesBufferSize];
+    forever {
+        const long size = syscall(SYS_getdents64, procFd, entries, sizeof(entries));
+        if (size <= 0)
+            break;
+
+        for (long offset = 0; offset < size;) {
+            const auto *entry = reinterpret_cast<const linux_dirent64 *>(entries + offset);
+            offset += entry->d_reclen;
+            if (entry->d_type != DT_DIR)
+                continue;
+
+            const pid_t pid = parsePid(entry->d_name);
+            if (pid <= 0 || pid == ownPid)
+                continue;
+
+            struct stat processStat;
+            if (isUsingDevice(procFd, entry->d_name, deviceNodes) && fstatat(procFd, entry->d_name, &processStat, 0) == 0)
+                processes.append({pid, processStat.st_uid, processName(procFd, entry->d_name)});
+        }
+    }
+
+    close(procFd);
+    return processes;
+}
+
+QVector<GpuProcess> GpuProcessScanner::closableProcesses(const QVector<GpuProcess> &processes)
+{
+    // The tray is started by the session, so its ancestors include the session leader
+    QSet<pid_t> ancestors;
+    for (pid_t pid = parentPid(getpid()); pid > 1 && !ancestors.contains(pid); pid = parentPid(pid))
+        ancestors.insert(pid);
+
+    const uid_t userId = getuid();
+    QVector<GpuProcess> closable;
+    for (const GpuProcess &process : processes) {
+        if (process.uid == userId && getsid(process.pid) != process.pid && !ancestors.contains(process.pid) && !isSessionProcess(process.name))
+            closable.append(process);
+    }
+
+    return closable;
+}
+
+void GpuProcessScanner::terminate(const QVector<GpuProcess> &processes)
+{
+    for (const GpuProcess &process : processes)
+        kill(process.pid, SIGTERM);
+}
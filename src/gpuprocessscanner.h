@@ -0,0 +1,54 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef GPUPROCESSSCANNER_H
+#define GPUPROCESSSCANNER_H
+
+#include <QByteArrayList>
+#include <QVector>
+
+#include <sys/types.h>
+
+struct GpuDevice;
+
+struct GpuProcess {
+    pid_t pid = 0;
+    uid_t uid = 0;
+    QString name;
+};
+
+namespace GpuProcessScanner
+{
+// Nodes used for rendering on the discrete GPU, nodes with trailing '*' are prefixes.
+// Card nodes are skipped, compositors open them for every GPU.
+QByteArrayList discreteGpuNodes(const GpuDevice *gpu);
+
+// Scan /proc/*/fd for processes that have any of the device nodes open.
+// Directory entries and links are read into fixed buffers, so only found processes allocate.
+QVector<GpuProcess> processesUsing(const QByteArrayList &deviceNodes);
+
+// Processes of the current user that can be closed without ending the desktop session.
+// Session leaders, ancestors of this process, display servers, compositors, shells and portals are removed.
+QVector<GpuProcess> closableProcesses(const QVector<GpuProcess> &processes);
+
+// Ask processes to close with SIGTERM
+void terminate(const QVector<GpuProcess> &processes);
+}
+
+#endif // GPUPROCESSSCANNER_H
@@ -0,0 +1,169 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "gputopology.h"
+
+#include "systempaths.h"
+#include "tracescope.h"
+#include "ueventmonitor.h"
+#include "settings/appsettings.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+
+#include <algorithm>
+
+GpuTopology *GpuTopology::s_instance = nullptr;
+
+GpuTopology::GpuTopology(QObject *parent)
+    : QObject(parent)
+    , m_ueventMonitor(new UeventMonitor(this))
+    , m_refreshTimer(new QTimer(this))
+    , m_seenVendors(AppSettings().seenGpuVendors())
+{
+    Q_ASSERT_X(s_instance == nullptr, "GpuTopology", "Only one instance is allowed");
+    s_instance = this;
+
+    // Devices usually generate several uevents at once
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(200);
+    connect(m_refreshTimer, &QTimer::timeout, this, &GpuTopology::refresh);
+    connect(m_ueventMonitor, &UeventMonitor::ueventReceived, this, &GpuTopology::onUeventReceived);
+
+    refresh();
+}
+
+GpuTopology::~GpuTopology()
+{
+    s_instance = nullptr;
+}
+
+GpuTopology *GpuTopology::instance()
+{
+    return s_instance;
+}
+
+const QVector<GpuDevice> &GpuTopology::devices() const
+{
+    return m_devices;
+}
+
+bool GpuTopology::mayHaveVendor(GpuDevice::Vendor vendor) const
+{
+    if (m_devices.isEmpty())
+        return true;
+
+    return std::any_of(m_devices.cbegin(), m_devices.cend(), [vendor](const GpuDevice &device) { return device.vendor == vendor; });
+}
+
+bool GpuTopology::wasVendorSeen(GpuDevice::Vendor vendor) const
+{
+    return mayHaveVendor(vendor) || (m_seenVendors & (1 << vendor)) != 0;
+}
+
+const GpuDevice *GpuTopology::discreteGpu() const
+{
+    if (m_devices.size() < 2)
+        return nullptr;
+
+    for (const GpuDevice &device : m_devices) {
+        if (!device.bootVga)
+            return &device;
+    }
+
+    return nullptr;
+}
+
+void GpuTopology::onUeventReceived(const QByteArray &, const QByteArray &subsystem)
+{
+    if (subsystem == "pci" || subsystem == "drm")
+        m_refreshTimer->start();
+}
+
+void GpuTopology::refresh()
+{
+    const TraceScope trace("GpuTopology::refresh");
+
+    QVector<GpuDevice> devices;
+    const QDir pciDevices(SystemPaths::resolve(QStringLiteral("/sys/bus/pci/devices")));
+    const QStringList addresses = pciDevices.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &address : addresses) {
+        const QDir deviceDir(pciDevices.filePath(address));
+        if (!readAttribute(deviceDir.filePath(QStringLiteral("class"))).startsWith("0x03"))
+            continue;
+
+        GpuDevice device;
+        device.address = address;
+        device.vendor = vendorFromId(readAttribute(deviceDir.filePath(QStringLiteral("vendor"))));
+        device.driver = QFileInfo(QFile::symLinkTarget(deviceDir.filePath(QStringLiteral("driver")))).fileName();
+        device.bootVga = readAttribute(deviceDir.filePath(QStringLiteral("boot_vga"))) == "1";
+        device.linkSpeed = readAttribute(deviceDir.filePath(QStringLiteral("current_link_speed")));
+        device.linkWidth = readAttribute(deviceDir.filePath(QStringLiteral("current_link_width"))).toInt();
+        devices.append(device);
+    }
+
+    // Assign DRM nodes (connectors like card0-eDP-1 are skipped)
+    const QDir drmClass(SystemPaths::resolve(QStringLiteral("/sys/class/drm")));
+    const QStringList drmNodes = drmClass.entryList({QStringLiteral("card*"), QStringLiteral("renderD*")}, QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &drmNode : drmNodes) {
+        if (drmNode.contains('-'))
+            continue;
+
+        const QString address = QFileInfo(drmClass.filePath(drmNode + QStringLiteral("/device"))).canonicalFilePath().section('/', -1);
+        for (GpuDevice &device : devices) {
+            if (device.address == address) {
+                device.drmNodes.append(QStringLiteral("/dev/dri/") + drmNode);
+                break;
+            }
+        }
+    }
+
+    int seenVendors = m_seenVendors;
+    for (const GpuDevice &device : qAsConst(devices))
+        seenVendors |= 1 << device.vendor;
+    if (seenVendors != m_seenVendors) {
+        m_seenVendors = seenVendors;
+        AppSettings().setSeenGpuVendors(m_seenVendors);
+    }
+
+    m_devices = devices;
+    emit changed();
+}
+
+GpuDevice::Vendor GpuTopology::vendorFromId(const QByteArray &vendorId)
+{
+    if (vendorId == "0x8086")
+        return GpuDevice::Intel;
+    if (vendorId == "0x1002")
+        return GpuDevice::Amd;
+    if (vendorId == "0x10de")
+        return GpuDevice::Nvidia;
+    return GpuDevice::OtherVendor;
+}
+
+QByteArray GpuTopology::readAttribute(const QString &path)
+{
+    QFile attribute(path);
+    if (!attribute.open(QIODevice::ReadOnly))
+        return {};
+
+    return attribute.readAll().trimmed();
+}
@@ -0,0 +1,92 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef GPUTOPOLOGY_H
+#define GPUTOPOLOGY_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class QTimer;
+class UeventMonitor;
+
+struct GpuDevice {
+    enum Vendor {
+        OtherVendor,
+        Intel,
+        Amd,
+        Nvidia
+    };
+
+    QString address; // PCI address
+    Vendor vendor = OtherVendor;
+    QString driver;
+    bool bootVga = false;
+    // Runtime PM status is not cached, it changes without uevents
+    QString linkSpeed;
+    int linkWidth = 0;
+    QStringList drmNodes; // Device node paths
+};
+
+// Display controllers read from sysfs.
+// Scanned once and refreshed only on PCI and DRM uevents.
+class GpuTopology : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(GpuTopology)
+
+public:
+    explicit GpuTopology(QObject *parent = nullptr);
+    ~GpuTopology() override;
+
+    // Topology created by the application, nullptr if not created yet
+    static GpuTopology *instance();
+
+    const QVector<GpuDevice> &devices() const;
+
+    // Returns true if a device with the vendor is present or topology is not available
+    bool mayHaveVendor(GpuDevice::Vendor vendor) const;
+
+    // Also true if the vendor was present earlier, devices can be removed from the bus by switching
+    bool wasVendorSeen(GpuDevice::Vendor vendor) const;
+
+    // Returns nullptr if there is no discrete GPU, pointer is valid until next refresh
+    const GpuDevice *discreteGpu() const;
+
+signals:
+    void changed();
+
+private slots:
+    void onUeventReceived(const QByteArray &action, const QByteArray &subsystem);
+    void refresh();
+
+private:
+    static GpuDevice::Vendor vendorFromId(const QByteArray &vendorId);
+    static QByteArray readAttribute(const QString &path);
+
+    static GpuTopology *s_instance;
+
+    UeventMonitor *m_ueventMonitor;
+    QTimer *m_refreshTimer;
+    QVector<GpuDevice> m_devices;
+    int m_seenVendors;
+};
+
+#endif // GPUTOPOLOGY_H
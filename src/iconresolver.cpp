@@ -0,0 +1,272 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "iconresolver.h"
+
+#include "tracescope.h"
+
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QPixmap>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QSettings>
+#include <QThreadPool>
+#include <QTimer>
+
+// Icon files of the current theme chain, built once by the worker
+struct IconIndex {
+    QStringList searchPaths;
+    QString themeName;
+    QStringList themes;
+    QHash<QString, QString> files;
+};
+
+namespace
+{
+// Recent names, including not existing ones typed in preview fields
+constexpr int s_cacheSize = 64;
+constexpr int s_debounceInterval = 150;
+
+IconResolver *s_instance = nullptr;
+
+// Size from theme directory name like "48x48", "48" or "48x48@2x"
+int directorySize(const QString &path)
+{
+    static const QRegularExpression sizeExpression(QStringLiteral("/(\\d+)(?:x\\d+)?(?:@\\d+x?)?/"));
+    return sizeExpression.match(path).captured(1).toInt();
+}
+
+void buildIndex(IconIndex *index, const QStringList &searchPaths, const QString &themeName)
+{
+    const TraceScope trace("IconIndex::build", themeName);
+    index->searchPaths = searchPaths;
+    index->themeName = themeName;
+    index->themes.clear();
+    index->files.clear();
+
+    // Follow inheritance, hicolor is always the last one
+    QStringList pendingThemes{themeName.isEmpty() ? QStringLiteral("hicolor") : themeName};
+    while (!pendingThemes.isEmpty()) {
+        const QString theme = pendingThemes.takeFirst();
+        if (theme.isEmpty() || index->themes.contains(theme))
+            continue;
+
+        index->themes.append(theme);
+        for (const QString &searchPath : searchPaths) {
+            const QString indexFile = searchPath + '/' + theme + QStringLiteral("/index.theme");
+            if (QFileInfo::exists(indexFile)) {
+                pendingThemes.append(QSettings(indexFile, QSettings::IniFormat).value(QStringLiteral("Icon Theme/Inherits")).toStringList());
+                break;
+            }
+        }
+        if (pendingThemes.isEmpty() && theme != QLatin1String("hicolor"))
+            pendingThemes.append(QStringLiteral("hicolor"));
+    }
+
+    for (const QString &theme : qAsConst(index->themes)) {
+        QHash<QString, QString> themeFiles;
+        for (const QString &searchPath : searchPaths) {
+            QDirIterator it(searchPath + '/' + theme, {QStringLiteral("*.svg"), QStringLiteral("*.svgz"), QStringLiteral("*.png")}, QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+            while (it.hasNext()) {
+                const QString path = it.next();
+                const QString name = it.fileInfo().completeBaseName();
+                if (index->files.contains(name))
+                    continue; // Already provided by a more specific theme
+
+                QString &current = themeFiles[name];
+                if (IconResolver::isBetterIconFile(path, current))
+                    current = path;
+            }
+        }
+        for (auto it = themeFiles.cbegin(); it != themeFiles.cend(); ++it)
+            index->files.insert(it.key(), it.value());
+    }
+}
+
+class IconLookup : public QRunnable
+{
+public:
+    IconLookup(IconResolver *resolver, IconIndex *index, int tag, int generation, const QString &name, int extent)
+        : m_resolver(resolver)
+        , m_index(index)
+        , m_tag(tag)
+        , m_generation(generation)
+        , m_name(name)
+        , m_extent(extent)
+        , m_searchPaths(QIcon::themeSearchPaths())
+        , m_themeName(QIcon::themeName())
+    {
+    }
+
+    void run() override
+    {
+        QString path;
+        if (QFileInfo(m_name).isAbsolute()) {
+            path = m_name;
+        } else {
+            if (m_index->searchPaths != m_searchPaths || m_index->themeName != m_themeName)
+                buildIndex(m_index, m_searchPaths, m_themeName);
+            path = m_index->files.value(m_name);
+        }
+
+        QImage image;
+        if (!path.isEmpty()) {
+            QImageReader reader(path);
+            reader.setScaledSize(reader.size().scaled(m_extent, m_extent, Qt::KeepAspectRatio));
+            image = reader.read();
+        }
+
+        QMetaObject::invokeMethod(m_resolver, "finish", Qt::QueuedConnection, Q_ARG(int, m_tag), Q_ARG(int, m_generation), Q_ARG(QString, m_name), Q_ARG(QString, path), Q_ARG(QImage, image));
+    }
+
+private:
+    IconResolver *m_resolver;
+    IconIndex *m_index;
+    const int m_tag;
+    const int m_generation;
+    const QString m_name;
+    const int m_extent;
+    const QStringList m_searchPaths;
+    const QString m_themeName;
+};
+}
+
+IconResolver::IconResolver(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_debounceTimer(new QTimer(this))
+    , m_cache(s_cacheSize)
+    , m_cacheThemeName(QIcon::themeName())
+{
+    // Single worker, so the index does not need locking
+    m_pool->setMaxThreadCount(1);
+
+    m_debounceTimer->setSingleShot(true);
+    m_debounceTimer->setInterval(s_debounceInterval);
+    connect(m_debounceTimer, &QTimer::timeout, this, &IconResolver::startPending);
+}
+
+IconResolver::~IconResolver()
+{
+    m_pool->clear();
+    m_pool->waitForDone();
+    delete m_index;
+    s_instance = nullptr;
+}
+
+IconResolver *IconResolver::instance()
+{
+    if (s_instance == nullptr)
+        s_instance = new IconResolver(QCoreApplication::instance());
+
+    return s_instance;
+}
+
+QIcon IconResolver::icon(const QString &name)
+{
+    clearStaleCache();
+    if (const QIcon *cachedIcon = m_cache.object(name); cachedIcon != nullptr)
+        return *cachedIcon;
+
+    QIcon icon;
+    if (QIcon::hasThemeIcon(name) || QFileInfo::exists(name))
+        icon = QIcon::fromTheme(name);
+
+    m_cache.insert(name, new QIcon(icon));
+    return icon;
+}
+
+void IconResolver::request(int tag, const QString &name, int extent)
+{
+    ++m_generations[tag];
+    clearStaleCache();
+    if (const QIcon *cachedIcon = m_cache.object(name); cachedIcon != nullptr) {
+        m_pending.remove(tag);
+        emit resolved(tag, *cachedIcon);
+        return;
+    }
+
+    m_pending.insert(tag, {name, extent});
+    m_debounceTimer->start();
+}
+
+bool IconResolver::isBetterIconFile(const QString &candidate, const QString &current)
+{
+    if (current.isEmpty())
+        return true;
+    if (!current.endsWith(QLatin1String(".png")))
+        return false;
+    if (!candidate.endsWith(QLatin1String(".png")))
+        return true;
+
+    return directorySize(candidate) > directorySize(current);
+}
+
+void IconResolver::releaseCaches()
+{
+    if (s_instance == nullptr)
+        return;
+
+    // Index can be freed only while the worker is idle, pending requests are started later anyway
+    s_instance->m_pool->waitForDone();
+    delete s_instance->m_index;
+    s_instance->m_index = nullptr;
+    s_instance->m_cache.clear();
+}
+
+void IconResolver::startPending()
+{
+    if (m_index == nullptr)
+        m_index = new IconIndex;
+
+    for (auto it = m_pending.cbegin(); it != m_pending.cend(); ++it)
+        m_pool->start(new IconLookup(this, m_index, it.key(), m_generations.value(it.key()), it->name, it->extent));
+    m_pending.clear();
+}
+
+// Cached lookups of the previous theme would be returned otherwise, the index is rebuilt by the worker
+void IconResolver::clearStaleCache()
+{
+    if (const QString themeName = QIcon::themeName(); themeName != m_cacheThemeName) {
+        m_cache.clear();
+        m_cacheThemeName = themeName;
+    }
+}
+
+void IconResolver::finish(int tag, int generation, const QString &name, const QString &path, const QImage &image)
+{
+    QIcon icon;
+    if (!path.isEmpty()) {
+        // Rendered size is ready, others are loaded lazily from the file
+        icon = QIcon(path);
+        if (!image.isNull())
+            icon.addPixmap(QPixmap::fromImage(image));
+        m_cache.insert(name, new QIcon(icon));
+    } else {
+        // Not found in theme directories, could be provided by platform theme
+        icon = this->icon(name);
+    }
+
+    // Results of replaced requests are only cached
+    if (generation == m_generations.value(tag))
+        emit resolved(tag, icon);
+}
@@ -0,0 +1,82 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ICONRESOLVER_H
+#define ICONRESOLVER_H
+
+#include <QCache>
+#include <QHash>
+#include <QIcon>
+
+class QThreadPool;
+class QTimer;
+struct IconIndex;
+
+// Resolves icon names and files without blocking GUI thread on every preview change.
+// Requests are debounced, theme lookup and rendering run on a worker thread,
+// results are kept in an LRU cache that is shared with synchronous lookups.
+class IconResolver : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(IconResolver)
+
+public:
+    ~IconResolver() override;
+
+    static IconResolver *instance();
+
+    // Returns cached icon or resolves it on the calling thread, null if the icon does not exist
+    QIcon icon(const QString &name);
+
+    // Emits resolved() later, a newer request with the same tag replaces the pending one
+    void request(int tag, const QString &name, int extent);
+
+    // Scalable icons are preferred, otherwise the largest one
+    static bool isBetterIconFile(const QString &candidate, const QString &current);
+
+    // Drops the theme index and cached icons if the resolver was created
+    static void releaseCaches();
+
+signals:
+    void resolved(int tag, const QIcon &icon);
+
+private slots:
+    void startPending();
+    void finish(int tag, int generation, const QString &name, const QString &path, const QImage &image);
+
+private:
+    struct PendingRequest {
+        QString name;
+        int extent = 0;
+    };
+
+    explicit IconResolver(QObject *parent = nullptr);
+
+    void clearStaleCache();
+
+    QThreadPool *m_pool;
+    QTimer *m_debounceTimer;
+    QHash<int, PendingRequest> m_pending;
+    QHash<int, int> m_generations; // Requests count per tag to drop replaced results
+    QCache<QString, QIcon> m_cache;
+    QString m_cacheThemeName; // Theme of cached icons
+    IconIndex *m_index = nullptr; // Created on first lookup, accessed only by the worker
+};
+
+#endif // ICONRESOLVER_H
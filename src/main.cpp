@@ -18,21 +18,277 @@
  */
 
 #include "cmake.h"
+#include "daemonclient.h"
+#include "gpuprocessscanner.h"
+#include "gputopology.h"
 #include "optimusmanager.h"
-#include "singleapplication.h"
+#include "renderoffload.h"
+#include "switchjournal.h"
+#include "switchlatency.h"
+#include "systempaths.h"
 #include "settings/appsettings.h"
 
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusError>
+#include <QDBusMessage>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <memory>
+
+namespace
+{
+void dumpJournal()
+{
+    QTextStream output(stdout);
+    for (const SwitchJournal::Entry &entry : SwitchJournal::entries()) {
+        output << QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString(Qt::ISODate)
+               << ' ' << SwitchJournal::operationString(entry.operation)
+               << ' ' << entry.mode
+               << ' ' << SwitchJournal::resultString(entry.outcome);
+        if (!entry.sendError.isEmpty())
+            output << " send_error=\"" << entry.sendError << '"';
+        if (!entry.logoutMethod.isEmpty())
+            output << " logout=" << entry.logoutMethod;
+        output << '\n';
+
+        for (const SwitchJournal::Phase &phase : entry.phases) {
+            output << "    " << phase.name << ' ' << SwitchJournal::resultString(phase.result)
+                   << " duration_us=" << phase.duration << " decision_wait_us=" << phase.decisionWait << '\n';
+        }
+    }
+}
+
+// Processes are scanned only in Hybrid mode, as by the tray
+void printPreflight()
+{
+    QByteArrayList gpuNodes;
+    if (OptimusManager::detectGpu() == OptimusSettings::Hybrid) {
+        const GpuTopology topology;
+        gpuNodes = GpuProcessScanner::discreteGpuNodes(topology.discreteGpu());
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const OptimusManager::PreflightResults results = OptimusManager::runPreflight(gpuNodes);
+    const qint64 duration = timer.nsecsElapsed() / 1000;
+
+    QTextStream(stdout) << "duration_us=" << duration
+                        << " daemon_active=" << results.daemonActive
+                        << " bumblebee_active=" << results.bumblebeeActive
+                        << " bbswitch_available=" << results.bbswitchAvailable
+                        << " nvidia_available=" << results.nvidiaAvailable
+                        << " sessions=" << results.sessions.size()
+                        << " session_types=" << results.sessionTypes.join(',')
+                        << " gpu_processes=" << results.gpuProcesses.size() << '\n';
+}
+
+void printGpuProcesses()
+{
+    const GpuTopology topology;
+    const QByteArrayList gpuNodes = GpuProcessScanner::discreteGpuNodes(topology.discreteGpu());
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<GpuProcess> processes = GpuProcessScanner::processesUsing(gpuNodes);
+    const qint64 duration = timer.nsecsElapsed() / 1000;
+
+    QTextStream output(stdout);
+    for (const GpuProcess &process : processes)
+        output << process.pid << ' ' << process.uid << ' ' << process.name << '\n';
+    output << "duration_us=" << duration << " nodes=" << gpuNodes.join(',') << " processes=" << processes.size() << '\n';
+}
+
+// Sends the configuration file content as the permanent daemon configuration, returns exit code
+int applyConfig(const QString &path)
+{
+    QFile configFile(path);
+    if (!configFile.open(QIODevice::ReadOnly)) {
+        QTextStream(stderr) << QCoreApplication::translate("main", "Unable to read %1: %2").arg(path, configFile.errorString()) << '\n';
+        return 1;
+    }
+
+    DaemonClient client;
+    client.connect();
+    if (client.error()) {
+        QTextStream(stderr) << DaemonClient::tr("Unable to connect to Optimus Manager daemon: %1").arg(client.errorString()) << '\n';
+        return 1;
+    }
+
+    client.setConfig(QTextStream(&configFile).readAll());
+    if (client.error()) {
+        QTextStream(stderr) << DaemonClient::tr("Unable to send configuration file to Optimus Manager daemon: %1").arg(client.errorString()) << '\n';
+        return 1;
+    }
+
+    return 0;
+}
+
+// Sends the command to the running instance, returns exit code
+int forwardCommand(const QDBusConnection &bus, const QString &method, const QVariantList &arguments)
+{
+    QDBusMessage command = QDBusMessage::createMethodCall(OptimusManagerAdaptor::serviceName(), OptimusManagerAdaptor::objectPath(),
+                                                          QStringLiteral("io.optimus_manager.OptimusManagerQt"), method);
+    command.setArguments(arguments);
+
+    const QDBusMessage reply = bus.call(command);
+    if (reply.type() == QDBusMessage::ErrorMessage) {
+        QTextStream(stderr) << reply.errorMessage() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
+
+int forwardCommandLine(const QDBusConnection &bus, const QCommandLineParser &parser, const QCommandLineOption &switchOption, const QCommandLineOption &settingsOption)
+{
+    if (parser.isSet(switchOption))
+        return forwardCommand(bus, QStringLiteral("SwitchMode"), {parser.value(switchOption)});
+    if (parser.isSet(settingsOption))
+        return forwardCommand(bus, QStringLiteral("OpenSettings"), {});
+    return 0;
+}
+}
+
 int main(int argc, char *argv[])
 {
-    SingleApplication app(argc, argv);
+    // Command line is handled without GUI, so launches that only forward commands stay cheap
+    auto coreApp = std::make_unique<QCoreApplication>(argc, argv);
     QCoreApplication::setApplicationName(QStringLiteral(APPLICATION_NAME));
     QCoreApplication::setOrganizationName(QStringLiteral(ORGANIZATION_NAME));
     QCoreApplication::setApplicationVersion(QStringLiteral("%1.%2.%3").arg(VERSION_MAJOR).arg(VERSION_MINOR).arg(VERSION_PATCH));
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    const QCommandLineOption sysrootOption(QStringLiteral("sysroot"),
+                                           QCoreApplication::translate("main", "Resolve probed system paths relative to <directory>, configuration files are not affected (also can be set with OPTIMUS_MANAGER_QT_SYSROOT)."),
+                                           QCoreApplication::translate("main", "directory"));
+    parser.addOption(sysrootOption);
+    const QCommandLineOption dumpJournalOption(QStringLiteral("dump-journal"), QCoreApplication::translate("main", "Print recorded GPU switches and configuration applies and exit."));
+    parser.addOption(dumpJournalOption);
+    const QCommandLineOption exportLatencyOption(QStringLiteral("export-latency"), QCoreApplication::translate("main", "Print switch latency histogram in Prometheus text format and exit."));
+    parser.addOption(exportLatencyOption);
+    const QCommandLineOption preflightOption(QStringLiteral("preflight"), QCoreApplication::translate("main", "Run switch preflight checks, print their results and duration and exit."));
+    parser.addOption(preflightOption);
+    const QCommandLineOption scanGpuProcessesOption(QStringLiteral("scan-gpu-processes"),
+                                                    QCoreApplication::translate("main", "Print processes using the discrete GPU and scan duration and exit."));
+    parser.addOption(scanGpuProcessesOption);
+    const QCommandLineOption applyConfigOption(QStringLiteral("apply-config"),
+                                               QCoreApplication::translate("main", "Send <file> to the daemon as the permanent configuration and exit."),
+                                               QCoreApplication::translate("main", "file"));
+    parser.addOption(applyConfigOption);
+    const QCommandLineOption switchOption(QStringLiteral("switch"),
+                                          QCoreApplication::translate("main", "Switch to <mode> (integrated, nvidia or hybrid), the running instance is used if present."),
+                                          QCoreApplication::translate("main", "mode"));
+    parser.addOption(switchOption);
+    const QCommandLineOption settingsOption(QStringLiteral("settings"), QCoreApplication::translate("main", "Open settings, the running instance is used if present."));
+    parser.addOption(settingsOption);
+    const QCommandLineOption offloadOption(QStringLiteral("offload"),
+                                           QCoreApplication::translate("main", "Run <command> or the offload rule with this name on the discrete GPU and exit."),
+                                           QCoreApplication::translate("main", "command"));
+    parser.addOption(offloadOption);
+    parser.process(*coreApp);
+
+    if (parser.isSet(dumpJournalOption)) {
+        dumpJournal();
+        return 0;
+    }
+
+    if (parser.isSet(exportLatencyOption)) {
+        QTextStream(stdout) << SwitchLatency::exportMetrics();
+        return 0;
+    }
+
+    if (parser.isSet(sysrootOption))
+        SystemPaths::setRoot(parser.value(sysrootOption));
+
+    if (parser.isSet(preflightOption)) {
+        printPreflight();
+        return 0;
+    }
+
+    if (parser.isSet(scanGpuProcessesOption)) {
+        printGpuProcesses();
+        return 0;
+    }
+
+    if (parser.isSet(applyConfigOption))
+        return applyConfig(parser.value(applyConfigOption));
+
+    if (parser.isSet(offloadOption)) {
+        QString command = parser.value(offloadOption);
+        for (const AppSettings::OffloadRule &rule : AppSettings().offloadRules()) {
+            if (rule.name == command) {
+                command = rule.command;
+                break;
+            }
+        }
+
+        // Offload variables select a driver that is not loaded in other modes
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        if (OptimusManager::detectGpu() == OptimusSettings::Hybrid) {
+            const GpuTopology topology;
+            environment = RenderOffload::environment(topology.discreteGpu());
+        } else {
+            QTextStream(stderr) << QCoreApplication::translate("main", "Offloading is available only in Hybrid mode, the command will run on the current GPU.") << '\n';
+        }
+
+        if (!RenderOffload::launch(command, environment)) {
+            QTextStream(stderr) << QCoreApplication::translate("main", "Unable to run %1").arg(command) << '\n';
+            return 1;
+        }
+        return 0;
+    }
+
+    OptimusSettings::Mode switchingMode = OptimusSettings::Auto;
+    if (parser.isSet(switchOption)) {
+        switchingMode = OptimusSettings::modeFromString(parser.value(switchOption), OptimusSettings::Auto);
+        if (switchingMode == OptimusSettings::Auto) {
+            QTextStream(stderr) << QCoreApplication::translate("main", "Unknown GPU mode: %1").arg(parser.value(switchOption)) << '\n';
+            return 1;
+        }
+    }
+
+    // Only one instance owns the name, other launches forward their commands to it.
+    // A private connection is used since the default one would not survive the application replacement.
+    {
+        QDBusConnection forwardBus = QDBusConnection::connectToBus(QDBusConnection::SessionBus, QStringLiteral("forward"));
+        const bool instanceRunning = forwardBus.isConnected() && forwardBus.interface()->isServiceRegistered(OptimusManagerAdaptor::serviceName());
+        const int exitCode = instanceRunning ? forwardCommandLine(forwardBus, parser, switchOption, settingsOption) : 0;
+        QDBusConnection::disconnectFromBus(QStringLiteral("forward"));
+        if (instanceRunning)
+            return exitCode;
+    }
+
+    coreApp.reset();
+    QApplication app(argc, argv);
     QGuiApplication::setDesktopFileName(QStringLiteral(DESKTOP_FILE));
     QGuiApplication::setQuitOnLastWindowClosed(false);
 
     // Tray menu
     OptimusManager manager;
+    new OptimusManagerAdaptor(&manager);
+
+    // Object is registered before the name, so forwarded calls never reach a name without it
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        qWarning("Unable to connect to session bus, single instance cannot be ensured: %s", qPrintable(bus.lastError().message()));
+    } else {
+        bus.registerObject(OptimusManagerAdaptor::objectPath(), &manager);
+        if (!bus.registerService(OptimusManagerAdaptor::serviceName())) // Other instance was started meanwhile
+            return forwardCommandLine(bus, parser, switchOption, settingsOption);
+    }
+
+    if (parser.isSet(switchOption))
+        QMetaObject::invokeMethod(&manager, [&manager, switchingMode] { manager.switchMode(switchingMode); }, Qt::QueuedConnection);
+    else if (parser.isSet(settingsOption))
+        QMetaObject::invokeMethod(&manager, &OptimusManager::openSettings, Qt::QueuedConnection);
 
     return QCoreApplication::exec();
 }
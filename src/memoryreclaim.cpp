@@ -0,0 +1,78 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memoryreclaim.h"
+
+#include "iconresolver.h"
+
+#include <QFile>
+#include <QIcon>
+#include <QPair>
+#include <QPixmapCache>
+
+#include <malloc.h>
+
+namespace
+{
+const bool s_debugEnabled = qEnvironmentVariableIsSet("OPTIMUS_MANAGER_QT_MEMORY_DEBUG");
+
+// Returns resident and proportional set sizes in kB
+QPair<qint64, qint64> memoryUsage()
+{
+    QPair<qint64, qint64> usage{-1, -1};
+
+    QFile smapsFile(QStringLiteral("/proc/self/smaps_rollup"));
+    if (!smapsFile.open(QIODevice::ReadOnly))
+        return usage;
+
+    while (!smapsFile.atEnd()) {
+        const QByteArray line = smapsFile.readLine();
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() < 2)
+            continue;
+
+        if (fields.constFirst() == "Rss:")
+            usage.first = fields.at(1).toLongLong();
+        else if (fields.constFirst() == "Pss:")
+            usage.second = fields.at(1).toLongLong();
+    }
+
+    return usage;
+}
+}
+
+void MemoryReclaim::reclaim()
+{
+    QPair<qint64, qint64> before;
+    if (s_debugEnabled)
+        before = memoryUsage();
+
+    QPixmapCache::clear();
+    IconResolver::releaseCaches();
+
+    // Setting search paths invalidates cached theme icons, tray icons will be reloaded on demand
+    QIcon::setThemeSearchPaths(QIcon::themeSearchPaths());
+
+    malloc_trim(0);
+
+    if (s_debugEnabled) {
+        const QPair<qint64, qint64> after = memoryUsage();
+        qInfo("Memory reclaimed: RSS %lld kB -> %lld kB, PSS %lld kB -> %lld kB", before.first, after.first, before.second, after.second);
+    }
+}
@@ -0,0 +1,140 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "metricsexporter.h"
+
+#include "cmake.h"
+#include "switchlatency.h"
+#include "settings/appsettings.h"
+
+#include <QMetaEnum>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <array>
+#include <optional>
+
+namespace
+{
+// Upper bounds of preflight duration histogram buckets in seconds
+constexpr std::array<double, 7> s_preflightBucketBounds = {0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1};
+
+std::optional<OptimusSettings::Mode> s_currentMode;
+
+QString metricName(const char *name)
+{
+    return QStringLiteral(PROJECT_NAME "_%1").arg(QLatin1String(name)).replace('-', '_');
+}
+}
+
+void MetricsExporter::setCurrentMode(OptimusSettings::Mode mode)
+{
+    s_currentMode = mode;
+    write();
+}
+
+// Counters are stored only while exporting is enabled
+void MetricsExporter::addOutcome(const SwitchJournal::Entry &entry)
+{
+    AppSettings settings;
+    if (settings.metricsFilePath().isEmpty())
+        return;
+
+    AppSettings::SwitchMetrics switchMetrics = settings.switchMetrics();
+    switchMetrics.preflightBuckets.resize(s_preflightBucketBounds.size() + 1);
+
+    const QString outcome = SwitchJournal::operationString(entry.operation) + '/' + SwitchJournal::resultString(entry.outcome);
+    switchMetrics.outcomes[outcome] = switchMetrics.outcomes.value(outcome).toInt() + 1;
+    if (!entry.sendError.isEmpty())
+        ++switchMetrics.sendErrors;
+
+    for (const SwitchJournal::Phase &phase : entry.phases) {
+        if (phase.name != QLatin1String("preflight"))
+            continue;
+
+        const double seconds = static_cast<double>(phase.duration) / 1000000;
+        const auto bound = std::lower_bound(s_preflightBucketBounds.cbegin(), s_preflightBucketBounds.cend(), seconds);
+        ++switchMetrics.preflightBuckets[static_cast<int>(bound - s_preflightBucketBounds.cbegin())];
+        switchMetrics.preflightSum += phase.duration;
+    }
+
+    settings.setSwitchMetrics(switchMetrics);
+    write();
+}
+
+void MetricsExporter::write()
+{
+    const QString path = AppSettings().metricsFilePath();
+    if (path.isEmpty())
+        return;
+
+    // Collector must never read a partially written file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Unable to open metrics file %s: %s", qPrintable(path), qPrintable(file.errorString()));
+        return;
+    }
+
+    file.write(metrics().toUtf8());
+    if (!file.commit())
+        qWarning("Unable to write metrics file %s: %s", qPrintable(path), qPrintable(file.errorString()));
+}
+
+QString MetricsExporter::metrics()
+{
+    AppSettings::SwitchMetrics switchMetrics = AppSettings().switchMetrics();
+    switchMetrics.preflightBuckets.resize(s_preflightBucketBounds.size() + 1);
+
+    QString metrics;
+    QTextStream stream(&metrics);
+
+    const QString modeName = metricName("gpu_mode");
+    stream << "# HELP " << modeName << " Currently active GPU mode.\n";
+    stream << "# TYPE " << modeName << " gauge\n";
+    for (OptimusSettings::Mode mode : {OptimusSettings::Integrated, OptimusSettings::Nvidia, OptimusSettings::Hybrid})
+        stream << modeName << "{mode=\"" << OptimusSettings::modeString(mode) << "\"} " << (s_currentMode == mode ? 1 : 0) << '\n';
+
+    const QString outcomesName = metricName("switches_total");
+    stream << "# HELP " << outcomesName << " Switches and configuration applies by result.\n";
+    stream << "# TYPE " << outcomesName << " counter\n";
+    for (auto it = switchMetrics.outcomes.cbegin(); it != switchMetrics.outcomes.cend(); ++it)
+        stream << outcomesName << "{operation=\"" << it.key().section('/', 0, 0) << "\",result=\"" << it.key().section('/', 1) << "\"} " << it.value().toInt() << '\n';
+
+    const QString sendErrorsName = metricName("daemon_send_errors_total");
+    stream << "# HELP " << sendErrorsName << " Failed connections and sends to Optimus Manager daemon.\n";
+    stream << "# TYPE " << sendErrorsName << " counter\n";
+    stream << sendErrorsName << ' ' << switchMetrics.sendErrors << '\n';
+
+    const QString preflightName = metricName("preflight_duration_seconds");
+    stream << "# HELP " << preflightName << " Time spent in switch preflight checks.\n";
+    stream << "# TYPE " << preflightName << " histogram\n";
+    int count = 0;
+    for (size_t i = 0; i < s_preflightBucketBounds.size(); ++i) {
+        count += switchMetrics.preflightBuckets.at(static_cast<int>(i));
+        stream << preflightName << "_bucket{le=\"" << s_preflightBucketBounds[i] << "\"} " << count << '\n';
+    }
+    count += switchMetrics.preflightBuckets.constLast();
+    stream << preflightName << "_bucket{le=\"+Inf\"} " << count << '\n';
+    stream << preflightName << "_sum " << static_cast<double>(switchMetrics.preflightSum) / 1000000 << '\n';
+    stream << preflightName << "_count " << count << '\n';
+
+    stream.flush();
+    return metrics + SwitchLatency::exportMetrics();
+}
@@ -0,0 +1,38 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include "switchjournal.h"
+#include "settings/optimussettings.h"
+
+// Writes GPU mode and switch metrics into a node_exporter textfile collector file.
+// The file is replaced atomically and only on changes, disabled if no path is set in application settings.
+// Switch counters are accumulated only while the path is set.
+namespace MetricsExporter
+{
+void setCurrentMode(OptimusSettings::Mode mode);
+void addOutcome(const SwitchJournal::Entry &entry);
+
+void write();
+QString metrics();
+}
+
+#endif // METRICSEXPORTER_H
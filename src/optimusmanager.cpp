@@ -20,37 +20,95 @@
 #include "optimusmanager.h"
 
 #include "daemonclient.h"
-#include "session.h"
-#include "settings/settingsdialog.h"
+#include "gpuprocessscanner.h"
+#include "gputopology.h"
+#include "iconresolver.h"
+#include "memoryreclaim.h"
+#include "metricsexporter.h"
+#include "pathprobe.h"
+#include "powerpolicy.h"
+#include "powersampler.h"
+#include "renderoffload.h"
+#ifdef WITH_NATIVE_SNI
+#include "statusnotifieritem.h"
+#endif
+#include "switchjournal.h"
+#include "switchlatency.h"
+#include "systemfactscache.h"
+#include "systempaths.h"
+#include "tracescope.h"
+#ifdef WITH_SETTINGS_PLUGIN
+#include "cmake.h"
+#include "settingsplugin.h"
+#else
+#include "settings/settingsdialogplugin.h"
+#endif
 
 #include <QCoreApplication>
 #include <QDBusArgument>
-#include <QDBusInterface>
+#include <QDBusConnection>
+#include <QDBusPendingReply>
+#include <QDBusReply>
+#include <QDialogButtonBox>
 #include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QInputDialog>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QLabel>
+#include <QListWidget>
 #include <QMenu>
 #include <QMessageBox>
 #include <QMetaEnum>
+#ifdef WITH_SETTINGS_PLUGIN
+#include <QPluginLoader>
+#endif
 #include <QProcess>
+#include <QPushButton>
 #include <QSettings>
-#ifdef WITH_PLASMA
+#include <QThread>
+#include <QVBoxLayout>
+#if defined(WITH_PLASMA)
 #include <KStatusNotifierItem>
-#else
+#elif !defined(WITH_NATIVE_SNI)
 #include <QSystemTrayIcon>
 #endif
 
+#include <algorithm>
 #include <csignal>
 
+namespace
+{
+// How long results of the preflight started on menu opening can be used
+constexpr qint64 s_preflightValidity = 5000;
+
+#ifdef WITH_SETTINGS_PLUGIN
+// Also search next to the executable to run from build directory
+QString settingsPluginPath()
+{
+    const QString fileName = QStringLiteral(PROJECT_NAME "-settings.so");
+    if (const QString installedPath = QStringLiteral(SETTINGS_PLUGIN_DIR "/") + fileName; QFileInfo::exists(installedPath))
+        return installedPath;
+
+    return QDir(QCoreApplication::applicationDirPath()).filePath(fileName);
+}
+#endif
+}
+
 OptimusManager::OptimusManager(QObject *parent)
     : QObject(parent)
     , m_contextMenu(new QMenu)
-#ifdef WITH_PLASMA
+#if defined(WITH_PLASMA)
     , m_trayIcon(new KStatusNotifierItem(this))
+#elif defined(WITH_NATIVE_SNI)
+    , m_trayIcon(new StatusNotifierItem(this))
 #else
     , m_trayIcon(new QSystemTrayIcon(this))
 #endif
+    , m_gpuTopology(new GpuTopology(this))
+    , m_powerSampler(new PowerSampler(this))
     , m_currentMode(detectGpu())
 {
     // Set localization
@@ -58,36 +116,54 @@ OptimusManager::OptimusManager(QObject *parent)
     appSettings.setupLocalization();
 
     // Setup context menu
-    m_openSettingsAction = m_contextMenu->addAction(QIcon::fromTheme(QStringLiteral("configure")), SettingsDialog::tr("Settings"), this, &OptimusManager::openSettings);
+    m_openSettingsAction = m_contextMenu->addAction(QIcon::fromTheme(QStringLiteral("configure")), QCoreApplication::translate("SettingsDialog", "Settings"), this, &OptimusManager::openSettings);
     m_contextMenu->addSeparator();
 
     const QMetaEnum modeEnum = QMetaEnum::fromType<OptimusSettings::Mode>();
     m_switchToIntegratedAction = m_contextMenu->addAction(tr("Switch to %1").arg(modeEnum.key(OptimusSettings::Integrated)), this, &OptimusManager::switchToIntegrated);
     m_switchToNvidiaAction = m_contextMenu->addAction(tr("Switch to %1").arg(modeEnum.key(OptimusSettings::Nvidia)), this, &OptimusManager::switchToNvidia);
     m_switchToHybridAction = m_contextMenu->addAction(tr("Switch to %1").arg(modeEnum.key(OptimusSettings::Hybrid)), this, &OptimusManager::switchToHybrid);
+    m_profilesMenu = m_contextMenu->addMenu(QIcon::fromTheme(QStringLiteral("document-properties")), tr("Apply profile"));
+    m_offloadMenu = m_contextMenu->addMenu(QIcon::fromTheme(QStringLiteral("system-run")), tr("Run on discrete GPU"));
     m_contextMenu->addSeparator();
 
     m_exitAction = m_contextMenu->addAction(QIcon::fromTheme(QStringLiteral("application-exit")), tr("Quit"), QCoreApplication::instance(), &QCoreApplication::quit);
 
     // Setup tray
-#ifdef WITH_PLASMA
+#if defined(WITH_PLASMA)
     m_trayIcon->setStandardActionsEnabled(false);
     m_trayIcon->setToolTipTitle(QCoreApplication::applicationName());
     m_trayIcon->setCategory(KStatusNotifierItem::SystemServices);
-    m_trayIcon->setToolTipSubTitle(tr("Current video card: %1").arg(QMetaEnum::fromType<OptimusSettings::Mode>().valueToKey(m_currentMode)));
+#elif defined(WITH_NATIVE_SNI)
+    m_trayIcon->setToolTipTitle(QCoreApplication::applicationName());
 #endif
     m_trayIcon->setContextMenu(m_contextMenu);
+    connect(m_contextMenu, &QMenu::aboutToShow, this, &OptimusManager::startPreflight);
+    updateToolTip();
+    connect(m_powerSampler, &PowerSampler::changed, this, &OptimusManager::updateToolTip);
 
     loadSettings(appSettings);
+    updateProfilesMenu();
+    updateOffloadMenu();
 
-#ifndef WITH_PLASMA
+#if !defined(WITH_PLASMA) && !defined(WITH_NATIVE_SNI)
     m_trayIcon->show();
 #endif
+
+    // Tray is shown in unknown state if the daemon has not written its state yet
+    if (m_currentMode) {
+        checkPendingSwitch();
+        MetricsExporter::setCurrentMode(*m_currentMode);
+    } else {
+        watchStateFile();
+    }
 }
 
 OptimusManager::~OptimusManager()
 {
-#ifndef WITH_PLASMA
+    if (m_preflightThread != nullptr)
+        m_preflightThread->wait();
+#if !defined(WITH_PLASMA) && !defined(WITH_NATIVE_SNI)
     delete m_contextMenu; // QSystemTrayIcon does not take ownership of QMenu
 #endif
 }
@@ -109,20 +185,103 @@ void OptimusManager::switchToHybrid()
 
 void OptimusManager::openSettings()
 {
-    SettingsDialog dialog;
-    if (dialog.exec() == QDialog::Rejected)
+    bool languageChanged = false;
+#ifdef WITH_SETTINGS_PLUGIN
+    QPluginLoader loader(settingsPluginPath());
+    auto *plugin = qobject_cast<SettingsPlugin *>(loader.instance());
+    if (plugin == nullptr) {
+        QMessageBox message;
+        message.setIcon(QMessageBox::Critical);
+        message.setText(tr("Unable to load settings module: %1").arg(loader.errorString()));
+        message.exec();
+        return;
+    }
+    const bool accepted = plugin->execSettingsDialog(languageChanged);
+
+    // Objects from the module scheduled for deletion must be destroyed before its code is unmapped
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    loader.unload();
+#else
+    SettingsDialogPlugin plugin;
+    const bool accepted = plugin.execSettingsDialog(languageChanged);
+#endif
+
+    if (accepted) {
+        if (languageChanged)
+            retranslateUi();
+
+        AppSettings settings;
+        loadSettings(settings);
+        MetricsExporter::write();
+    }
+
+    // Profiles are saved without accepting the dialog
+    updateProfilesMenu();
+    updateOffloadMenu();
+
+    // Dialog is destroyed, drop its caches
+    MemoryReclaim::reclaim();
+}
+
+void OptimusManager::startPreflight()
+{
+    if (m_preflightThread != nullptr || (m_preflightAge.isValid() && !m_preflightAge.hasExpired(s_preflightValidity)))
+        return;
+
+    m_preflightThread = QThread::create([this, gpuNodes = scannedGpuNodes()] {
+        m_threadPreflight = runPreflight(gpuNodes);
+    });
+    connect(m_preflightThread, &QThread::finished, this, &OptimusManager::finishPreflight);
+    m_preflightThread->start();
+}
+
+void OptimusManager::finishPreflight()
+{
+    // Could be already finished by a switch
+    if (m_preflightThread == nullptr)
+        return;
+
+    m_preflightThread->wait();
+    m_preflightThread->deleteLater();
+    m_preflightThread = nullptr;
+
+    m_preflight = m_threadPreflight;
+    m_preflightAge.start();
+}
+
+void OptimusManager::updateCurrentMode()
+{
+    const std::optional<OptimusSettings::Mode> mode = detectGpu();
+    if (!mode) {
+        watchStateFile();
         return;
+    }
 
-    if (dialog.isLanguageChanged())
-        retranslateUi();
+    delete m_stateWatcher;
+    m_stateWatcher = nullptr;
 
-    AppSettings settings;
-    loadSettings(settings);
+    m_currentMode = mode;
+    if (m_powerPolicy != nullptr)
+        m_powerPolicy->setRequestedMode(*m_currentMode);
+    AppSettings appSettings;
+    updateTrayIcon(appSettings);
+    updateToolTip();
+    updateOffloadMenu();
+    checkPendingSwitch();
+    MetricsExporter::setCurrentMode(*m_currentMode);
+}
+
+void OptimusManager::runOffloadCommand()
+{
+    bool accepted = false;
+    const QString command = QInputDialog::getText(nullptr, tr("Run on discrete GPU"), tr("Command:"), QLineEdit::Normal, {}, &accepted);
+    if (accepted && !command.trimmed().isEmpty())
+        launchOffloaded(command.trimmed());
 }
 
 void OptimusManager::showNotification(const QString &title, const QString &message)
 {
-#ifdef WITH_PLASMA
+#if defined(WITH_PLASMA) || defined(WITH_NATIVE_SNI)
     m_trayIcon->showMessage(title, message, m_trayIcon->iconName());
 #else
     m_trayIcon->showMessage(title, message);
@@ -136,42 +295,211 @@ void OptimusManager::loadSettings(AppSettings &appSettings)
     m_switchToNvidiaAction->setIcon(appSettings.modeIcon(OptimusSettings::Nvidia));
     m_switchToHybridAction->setIcon(appSettings.modeIcon(OptimusSettings::Hybrid));
 
-    // Tray icon
-    QString modeIconName = appSettings.modeIconName(m_currentMode);
-    if (!QIcon::hasThemeIcon(modeIconName) && !QFileInfo::exists(modeIconName)) {
-        modeIconName = AppSettings::defaultModeIconName(m_currentMode);
-        appSettings.setModeIconName(m_currentMode, modeIconName);
-        showNotification(tr("Invalid icon"), tr("The specified icon '%1' for the current GPU is invalid. The default icon will be used.").arg(modeIconName));
+    if (appSettings.isPowerPolicyEnabled() && m_powerPolicy == nullptr) {
+        m_powerPolicy = new PowerPolicy(m_currentMode, this);
+    } else if (!appSettings.isPowerPolicyEnabled()) {
+        delete m_powerPolicy;
+        m_powerPolicy = nullptr;
+    }
+
+    updateTrayIcon(appSettings);
+}
+
+void OptimusManager::updateTrayIcon(AppSettings &appSettings)
+{
+    QString modeIconName = QStringLiteral("optimus-manager");
+    if (m_currentMode) {
+        modeIconName = appSettings.modeIconName(*m_currentMode);
+        if (IconResolver::instance()->icon(modeIconName).isNull()) {
+            modeIconName = AppSettings::defaultModeIconName(*m_currentMode);
+            appSettings.setModeIconName(*m_currentMode, modeIconName);
+            showNotification(tr("Invalid icon"), tr("The specified icon '%1' for the current GPU is invalid. The default icon will be used.").arg(modeIconName));
+        }
     }
-#ifdef WITH_PLASMA
+#if defined(WITH_PLASMA) || defined(WITH_NATIVE_SNI)
     m_trayIcon->setIconByName(modeIconName);
     m_trayIcon->setToolTipIconByName(m_trayIcon->iconName());
 #else
-    m_trayIcon->setIcon(QIcon::fromTheme(modeIconName));
+    m_trayIcon->setIcon(IconResolver::instance()->icon(modeIconName));
 #endif
 }
 
+// Daemon creates the state directory and file at startup, so the nearest existing path is watched
+void OptimusManager::watchStateFile()
+{
+    if (m_stateWatcher == nullptr) {
+        m_stateWatcher = new QFileSystemWatcher(this);
+        connect(m_stateWatcher, &QFileSystemWatcher::directoryChanged, this, &OptimusManager::updateCurrentMode);
+        connect(m_stateWatcher, &QFileSystemWatcher::fileChanged, this, &OptimusManager::updateCurrentMode);
+    }
+
+    QString path = SystemPaths::stateFile();
+    while (!QFileInfo::exists(path) && QFileInfo(path).path() != path)
+        path = QFileInfo(path).path();
+
+    // File can exist but not be written completely yet
+    if (!m_stateWatcher->files().contains(path) && !m_stateWatcher->directories().contains(path))
+        m_stateWatcher->addPath(path);
+}
+
 void OptimusManager::retranslateUi()
 {
-#ifdef WITH_PLASMA
-    m_trayIcon->setToolTipSubTitle(tr("Current video card: %1").arg(QMetaEnum::fromType<OptimusSettings::Mode>().valueToKey(m_currentMode)));
-#endif
-    m_openSettingsAction->setText(SettingsDialog::tr("Settings"));
+    updateToolTip();
+    m_openSettingsAction->setText(QCoreApplication::translate("SettingsDialog", "Settings"));
 
     const QMetaEnum modeEnum = QMetaEnum::fromType<OptimusSettings::Mode>();
     m_switchToIntegratedAction->setText(tr("Switch to %1").arg(modeEnum.key(OptimusSettings::Integrated)));
     m_switchToNvidiaAction->setText(tr("Switch to %1").arg(modeEnum.key(OptimusSettings::Nvidia)));
     m_switchToHybridAction->setText(tr("Switch to %1").arg(modeEnum.key(OptimusSettings::Hybrid)));
+    m_profilesMenu->setTitle(tr("Apply profile"));
+    updateOffloadMenu();
 
     m_exitAction->setText(tr("Quit"));
 }
 
+void OptimusManager::updateToolTip()
+{
+    QStringList toolTipLines;
+#if !defined(WITH_PLASMA) && !defined(WITH_NATIVE_SNI)
+    toolTipLines.append(QCoreApplication::applicationName()); // StatusNotifierItem displays it as title
+#endif
+    if (m_currentMode)
+        toolTipLines.append(tr("Current video card: %1").arg(QMetaEnum::fromType<OptimusSettings::Mode>().valueToKey(*m_currentMode)));
+    else
+        toolTipLines.append(tr("Current video card: %1").arg(tr("unknown, waiting for Optimus Manager daemon")));
+
+    if (const qint64 power = m_powerSampler->averagePower(); power != -1)
+        toolTipLines.append(tr("Average power draw: %1 W").arg(static_cast<double>(power) / 1000, 0, 'f', 1));
+
+    switch (m_powerSampler->gpuPowerStatus()) {
+    case PowerSampler::Active:
+        toolTipLines.append(tr("Discrete GPU: active"));
+        break;
+    case PowerSampler::Suspended:
+        toolTipLines.append(tr("Discrete GPU: suspended"));
+        break;
+    case PowerSampler::UnknownStatus:
+        break;
+    }
+
+#if defined(WITH_PLASMA) || defined(WITH_NATIVE_SNI)
+    m_trayIcon->setToolTipSubTitle(toolTipLines.join(QStringLiteral("<br>")));
+#else
+    m_trayIcon->setToolTip(toolTipLines.join('\n'));
+#endif
+}
+
+void OptimusManager::updateProfilesMenu()
+{
+    m_profilesMenu->clear();
+
+    const QVector<AppSettings::ConfigProfile> profiles = AppSettings().configProfiles();
+    for (const AppSettings::ConfigProfile &profile : profiles)
+        m_profilesMenu->addAction(profile.name, this, [this, profile] { applyProfile(profile); });
+
+    m_profilesMenu->menuAction()->setVisible(!profiles.isEmpty());
+}
+
+// Profile already contains the daemon command, so applying is a single send
+void OptimusManager::applyProfile(const AppSettings::ConfigProfile &profile)
+{
+    SwitchJournal::Recorder journal(SwitchJournal::ConfigApply, profile.name);
+
+    journal.beginPhase(QStringLiteral("daemonConnect"));
+    DaemonClient client;
+    client.connect();
+    if (client.error()) {
+        journal.setResult(SwitchJournal::Failed);
+        journal.setSendError(client.errorString());
+        QMessageBox message;
+        message.setIcon(QMessageBox::Critical);
+        message.setText(DaemonClient::tr("Unable to connect to Optimus Manager daemon: %1").arg(client.errorString()));
+        execMessage(message);
+        return;
+    }
+
+    journal.beginPhase(QStringLiteral("daemonSend"));
+    client.sendRawCommand(profile.command);
+    if (client.error()) {
+        journal.setResult(SwitchJournal::Failed);
+        journal.setSendError(client.errorString());
+        QMessageBox message;
+        message.setIcon(QMessageBox::Critical);
+        message.setText(DaemonClient::tr("Unable to send configuration file to Optimus Manager daemon: %1").arg(client.errorString()));
+        execMessage(message);
+        return;
+    }
+
+    showNotification(tr("Profile applied"), tr("Configuration from profile '%1' will be used for the next GPU switch.").arg(profile.name));
+}
+
+// Offloading is only meaningful in Hybrid mode, in Nvidia mode everything already runs on the discrete GPU
+void OptimusManager::updateOffloadMenu()
+{
+    m_offloadMenu->clear();
+
+    const QVector<AppSettings::OffloadRule> rules = AppSettings().offloadRules();
+    for (const AppSettings::OffloadRule &rule : rules)
+        m_offloadMenu->addAction(rule.name, this, [this, command = rule.command] { launchOffloaded(command); });
+    if (!rules.isEmpty())
+        m_offloadMenu->addSeparator();
+    m_offloadMenu->addAction(QIcon::fromTheme(QStringLiteral("system-run")), tr("Run command…"), this, &OptimusManager::runOffloadCommand);
+
+    m_offloadMenu->setTitle(tr("Run on discrete GPU"));
+    m_offloadMenu->menuAction()->setVisible(m_currentMode == OptimusSettings::Hybrid);
+}
+
+void OptimusManager::launchOffloaded(const QString &command)
+{
+    if (!RenderOffload::launch(command, RenderOffload::environment(m_gpuTopology->discreteGpu()))) {
+        QMessageBox message;
+        message.setIcon(QMessageBox::Critical);
+        message.setText(tr("Unable to run '%1' on the discrete GPU.").arg(command));
+        execMessage(message);
+    }
+}
+
+// Compare the switch requested in a previous session with the current mode
+void OptimusManager::checkPendingSwitch()
+{
+    AppSettings appSettings;
+    const AppSettings::PendingSwitch pendingSwitch = appSettings.pendingSwitch();
+    if (!pendingSwitch.clickTime.isValid())
+        return;
+
+    // Wait until X server is restarted
+    const QDateTime xorgStartTime = SwitchLatency::xorgStartTime();
+    if (!xorgStartTime.isValid() || xorgStartTime < pendingSwitch.sendTime)
+        return;
+
+    appSettings.removePendingSwitch();
+    if (pendingSwitch.mode != m_currentMode) {
+        SwitchLatency::addMismatch();
+        showNotification(tr("GPU switch was not applied"), tr("Switching to %1 was requested, but %2 is active. Check Optimus Manager daemon logs for details.")
+                                                             .arg(OptimusSettings::modeString(pendingSwitch.mode), OptimusSettings::modeString(*m_currentMode)));
+        return;
+    }
+
+    // Manual re-login time depends on the user, so only automatic logouts are accounted
+    if (!pendingSwitch.logoutTime.isValid())
+        return;
+
+    const qint64 latency = pendingSwitch.clickTime.msecsTo(xorgStartTime);
+    SwitchLatency::addLatency(latency);
+    qInfo("Switch to %s took %lld ms: %lld ms to send, %lld ms to logout, %lld ms to start X server", qPrintable(OptimusSettings::modeString(pendingSwitch.mode)), latency,
+          pendingSwitch.clickTime.msecsTo(pendingSwitch.sendTime), pendingSwitch.sendTime.msecsTo(pendingSwitch.logoutTime), pendingSwitch.logoutTime.msecsTo(xorgStartTime));
+}
+
 void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
 {
-    const AppSettings appSettings;
+    const TraceScope trace("switchMode", [switchingMode] { return OptimusSettings::modeString(switchingMode); });
+    SwitchJournal::Recorder journal(SwitchJournal::Switch, OptimusSettings::modeString(switchingMode));
+    const QDateTime clickTime = QDateTime::currentDateTime();
+    AppSettings appSettings;
     const OptimusSettings optimusSettings;
 
     // Confirm message
+    journal.beginPhase(QStringLiteral("confirm"));
     if (appSettings.isConfirmSwitching()) {
         QMessageBox message;
         message.setStandardButtons(QMessageBox::Apply | QMessageBox::Cancel);
@@ -181,22 +509,36 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
             message.setInformativeText(tr("You will be automatically logged out to apply the changes."));
         else
             message.setInformativeText(tr("After applying the settings, you will need to manually re-login to change the video card."));
-        if (message.exec() != QMessageBox::Apply)
+        if (execMessage(message) != QMessageBox::Apply) {
+            journal.setResult(SwitchJournal::Cancelled);
             return;
+        }
     }
 
+    // Use results of the checks started on menu opening if they are fresh
+    journal.beginPhase(QStringLiteral("preflight"));
+    const PreflightResults preflight = takePreflight();
+    const QHash<QString, bool> &existingPaths = preflight.existingPaths;
+    const QString xorgConfig = SystemPaths::xorgConfigFile();
+    const QString mhwdConfig = SystemPaths::mhwdConfigFile();
+    const QString intelDriver = SystemPaths::xorgDriverFile(QStringLiteral("intel"));
+    const QString amdDriver = SystemPaths::xorgDriverFile(QStringLiteral("amdgpu"));
+
     // Check if daemon is active
-    if (const QString daemon = QStringLiteral("optimus-manager.service"); !isServiceActive(daemon) && !QFileInfo::exists(QStringLiteral("/var/service/optimus-manager/run"))) {
+    journal.beginPhase(QStringLiteral("daemonService"));
+    if (const QString daemon = QStringLiteral("optimus-manager.service"); !preflight.daemonActive && !existingPaths.value(SystemPaths::runitServiceFile())) {
         QMessageBox message;
         message.setIcon(QMessageBox::Critical);
         message.setText(tr("The %1 is running.").arg(daemon));
         message.setInformativeText(tr("Please enable and start it with:\n'%1'\n'%2'")
                                        .arg("sudo systemctl enable optimus-manager", "sudo systemctl start optimus-manager"));
-        message.exec();
+        execMessage(message);
+        journal.setResult(SwitchJournal::Failed);
         return;
     }
 
     // Check if power switching enabled
+    journal.beginPhase(QStringLiteral("powerManagement"));
     if (optimusSettings.switchingMethod() == OptimusSettings::NoneMethod
         && !optimusSettings.isPciPowerControlEnabled()
         && optimusSettings.nvidiaDynamicPowerManagement() == OptimusSettings::No) {
@@ -206,12 +548,14 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
         message.setInformativeText(tr("Switching between GPUs will work but you will likely experience poor battery life.<br>"
                                       "Follow <a href='https://github.com/Askannz/optimus-manager/wiki/A-guide--to-power-management-options'>these</a> instructions"
                                       " to enable power management."));
-        message.exec();
+        execMessage(message);
+        journal.setResult(SwitchJournal::Warned);
     }
 
     // Check if bbswitch module is available
+    journal.beginPhase(QStringLiteral("bbswitchModule"));
     if (optimusSettings.switchingMethod() == OptimusSettings::Bbswitch) {
-        if (const QString bbswitch = QStringLiteral("bbswitch"); !isModuleAvailable(bbswitch)) {
+        if (const QString bbswitch = QStringLiteral("bbswitch"); !preflight.bbswitchAvailable) {
             QMessageBox message;
             message.setIcon(QMessageBox::Warning);
             message.setText(tr("The %1 module does not seem to be available for the current kernel.").arg(bbswitch));
@@ -219,25 +563,31 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
                                           "You can set '%1' for GPU switching in settings or install bbswitch for"
                                           " the default kernel with '%2' or for all kernels with '%3'.")
                                            .arg("nouveau", "sudo pacman -S bbswitch", "sudo pacman -S bbswitch-dkms"));
-            message.exec();
+            execMessage(message);
+            journal.setResult(SwitchJournal::Warned);
         }
     }
 
     // Check if nvidia module is available
+    journal.beginPhase(QStringLiteral("nvidiaModule"));
     if (switchingMode == OptimusSettings::Nvidia) {
-        if (const QString nvidia = QStringLiteral("nvidia"); !isModuleAvailable(nvidia)) {
+        if (const QString nvidia = QStringLiteral("nvidia"); !preflight.nvidiaAvailable) {
             QMessageBox message;
             message.setIcon(QMessageBox::Question);
             message.setText(tr("The %1 module does not seem to be available for the current kernel.").arg(nvidia));
             message.setInformativeText(tr("It is likely the Nvidia driver was not properly installed. GPU switching will probably fail, continue anyway?"));
             message.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-            if (message.exec() == QMessageBox::No)
+            if (execMessage(message) == QMessageBox::No) {
+                journal.setResult(SwitchJournal::Cancelled);
                 return;
+            }
+            journal.setResult(SwitchJournal::Warned);
         }
     }
 
     // Check if GDM is patched
-    if (currentDisplayManager() == QLatin1String("/usr/bin/gdm") && !isGdmPatched()) {
+    journal.beginPhase(QStringLiteral("gdm"));
+    if (preflight.displayManager == QLatin1String("/usr/bin/gdm") && !isGdmPatched(existingPaths)) {
         QMessageBox message;
         message.setIcon(QMessageBox::Question);
         message.setText(tr("Looks like you're using a non-patched version of the GNOME Display Manager (GDM)."));
@@ -245,12 +595,16 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
                                       " instructions to install a patched version. Without a patched GDM version, GPU switching will likely fail.\n"
                                       "Continue anyway?"));
         message.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-        if (message.exec() == QMessageBox::No)
+        if (execMessage(message) == QMessageBox::No) {
+            journal.setResult(SwitchJournal::Cancelled);
             return;
+        }
+        journal.setResult(SwitchJournal::Warned);
     }
 
     // Check number of sessions
-    const QVector<Session> sessions = activeSessions();
+    journal.beginPhase(QStringLiteral("sessions"));
+    const QVector<Session> &sessions = preflight.sessions;
     if (const int activeSessions = sessionsCountWithoutGdm(sessions); activeSessions > 1) {
         QMessageBox message;
         message.setIcon(QMessageBox::Question);
@@ -260,15 +614,19 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
                                       "Continue?")
                                        .arg(activeSessions - 1));
         message.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-        if (message.exec() == QMessageBox::No)
+        if (execMessage(message) == QMessageBox::No) {
+            journal.setResult(SwitchJournal::Cancelled);
             return;
+        }
+        journal.setResult(SwitchJournal::Warned);
     }
 
     // Check if Wayland sessions are running
-    for (const Session &session : sessions) {
-        const QDBusInterface sessionInterface(QStringLiteral("org.freedesktop.login1"), session.sessionObjectPath.path(),
-                                              QStringLiteral("org.freedesktop.login1.Session"), QDBusConnection::systemBus());
-        if (sessionInterface.property("Type").toString() == QLatin1String("wayland")) {
+    journal.beginPhase(QStringLiteral("wayland"));
+    const QStringList &types = preflight.sessionTypes;
+    for (int i = 0; i < sessions.size(); ++i) {
+        const Session &session = sessions[i];
+        if (types[i] == QLatin1String("wayland")) {
             QMessageBox message;
             message.setIcon(QMessageBox::Question);
             message.setText(tr("Wayland session found."));
@@ -277,16 +635,20 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
                                           "Continue anyway?")
                                            .arg(QString::number(session.userId), session.userName));
             message.setStandardButtons(QMessageBox::Yes | QMessageBox::YesToAll | QMessageBox::No);
-            message.exec();
-            if (message.result() == QMessageBox::No)
+            execMessage(message);
+            if (message.result() == QMessageBox::No) {
+                journal.setResult(SwitchJournal::Cancelled);
                 return;
+            }
+            journal.setResult(SwitchJournal::Warned);
             if (message.result() == QMessageBox::YesToAll)
                 break;
         }
     }
 
     // Check if Bumblebee service is active
-    if (const QString bumblebeed = QStringLiteral("bumblebeed.service"); isServiceActive(bumblebeed)) {
+    journal.beginPhase(QStringLiteral("bumblebee"));
+    if (const QString bumblebeed = QStringLiteral("bumblebeed.service"); preflight.bumblebeeActive) {
         QMessageBox message;
         message.setIcon(QMessageBox::Question);
         message.setText(tr("The %1 is running.").arg(bumblebeed));
@@ -295,12 +657,16 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
                                       "Ignore this warning and proceed with GPU switching now?")
                                        .arg(QStringLiteral("sudo systemctl disable bumblebeed.service")));
         message.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-        if (message.exec() == QMessageBox::No)
+        if (execMessage(message) == QMessageBox::No) {
+            journal.setResult(SwitchJournal::Cancelled);
             return;
+        }
+        journal.setResult(SwitchJournal::Warned);
     }
 
     // Check if the default xorg config is exists
-    if (const QString xorgConfig QStringLiteral("/etc/X11/xorg.conf"); QFileInfo::exists(xorgConfig)) {
+    journal.beginPhase(QStringLiteral("xorgConfig"));
+    if (existingPaths.value(xorgConfig)) {
         QMessageBox message;
         message.setIcon(QMessageBox::Question);
         message.setText(tr("Found a Xorg config file at '%1'.").arg(xorgConfig));
@@ -309,12 +675,16 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
                                       " so it is recommended that you delete it before proceeding.\n"
                                       "Ignore this warning and proceed with GPU switching?"));
         message.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-        if (message.exec() == QMessageBox::No)
+        if (execMessage(message) == QMessageBox::No) {
+            journal.setResult(SwitchJournal::Cancelled);
             return;
+        }
+        journal.setResult(SwitchJournal::Warned);
     }
 
     // Check if the Manjaro MHWD config is exists
-    if (const QString mhwdConfig = QStringLiteral("/etc/X11/xorg.conf.d/90-mhwd.conf"); QFileInfo::exists(mhwdConfig)) {
+    journal.beginPhase(QStringLiteral("mhwdConfig"));
+    if (existingPaths.value(mhwdConfig)) {
         QMessageBox message;
         message.setIcon(QMessageBox::Question);
         message.setText(tr("Found a Xorg config file at '%1'.").arg(mhwdConfig));
@@ -322,14 +692,21 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
                                       " so Optimus Manager will delete this file automatically if you proceded with GPU switching.\n"
                                       "Proceed?"));
         message.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-        if (message.exec() == QMessageBox::No)
+        if (execMessage(message) == QMessageBox::No) {
+            journal.setResult(SwitchJournal::Cancelled);
             return;
+        }
+        journal.setResult(SwitchJournal::Warned);
     }
 
-    // Check if the Xorg driver is installed
-    if (switchingMode == OptimusSettings::Integrated
-        && optimusSettings.intelDriver() == OptimusSettings::Intel && !QFileInfo::exists(QStringLiteral("/usr/lib/xorg/modules/drivers/intel_drv.so"))
-        && optimusSettings.amdDriver() == OptimusSettings::Amd && !QFileInfo::exists(QStringLiteral("/usr/lib/xorg/modules/drivers/amdgpu_drv.so"))) {
+    // Check if the Xorg driver is installed (only for present integrated GPUs)
+    journal.beginPhase(QStringLiteral("xorgDriver"));
+    const bool hasIntel = m_gpuTopology->mayHaveVendor(GpuDevice::Intel);
+    const bool hasAmd = m_gpuTopology->mayHaveVendor(GpuDevice::Amd);
+    const bool intelDriverMissing = optimusSettings.intelDriver() == OptimusSettings::Intel && !existingPaths.value(intelDriver);
+    const bool amdDriverMissing = optimusSettings.amdDriver() == OptimusSettings::Amd && !existingPaths.value(amdDriver);
+    if (switchingMode == OptimusSettings::Integrated && (hasIntel || hasAmd)
+        && (!hasIntel || intelDriverMissing) && (!hasAmd || amdDriverMissing)) {
         QMessageBox message;
         message.setIcon(QMessageBox::Question);
         message.setText(tr("The Xorg driver is not installed."));
@@ -338,51 +715,138 @@ void OptimusManager::switchMode(OptimusSettings::Mode switchingMode)
                                       "Continue anyway?")
                                        .arg("modesetting", "Intel/AMD", "xf86-video-intel/xf86-video-amdgpu"));
         message.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-        if (message.exec() == QMessageBox::No)
+        if (execMessage(message) == QMessageBox::No) {
+            journal.setResult(SwitchJournal::Cancelled);
+            return;
+        }
+        journal.setResult(SwitchJournal::Warned);
+    }
+
+    // Check if applications are using the discrete GPU, scanned with other preflight checks
+    journal.beginPhase(QStringLiteral("gpuProcesses"));
+    if (const QVector<GpuProcess> processes = GpuProcessScanner::closableProcesses(preflight.gpuProcesses); !processes.isEmpty()) {
+        bool cancelled = false;
+        const QVector<GpuProcess> selectedProcesses = selectProcessesToClose(processes, cancelled);
+        if (cancelled) {
+            journal.setResult(SwitchJournal::Cancelled);
             return;
+        }
+        journal.setResult(SwitchJournal::Warned);
+        GpuProcessScanner::terminate(selectedProcesses);
     }
 
     // Connect to Optimus Manager daemon
+    journal.beginPhase(QStringLiteral("daemonConnect"));
     DaemonClient client;
     client.connect();
     if (client.error()) {
+        journal.setResult(SwitchJournal::Failed);
+        journal.setSendError(client.errorString());
         QMessageBox message;
         message.setIcon(QMessageBox::Critical);
         message.setText(DaemonClient::tr("Unable to connect to Optimus Manager daemon: %1").arg(client.errorString()));
-        message.exec();
+        execMessage(message);
         return;
     }
 
     // Send GPU string to Optimus Manager daemon
+    journal.beginPhase(QStringLiteral("daemonSend"));
     client.setGpu(switchingMode);
     if (client.error()) {
+        journal.setResult(SwitchJournal::Failed);
+        journal.setSendError(client.errorString());
         QMessageBox message;
         message.setIcon(QMessageBox::Critical);
         message.setText(DaemonClient::tr("Unable to send GPU name to switch to Optimus Manager daemon: %1").arg(client.errorString()));
-        message.exec();
+        execMessage(message);
         return;
     }
 
+    if (m_powerPolicy != nullptr)
+        m_powerPolicy->setRequestedMode(switchingMode);
+
+    // Remember the switch to check it in the next session, saved before logout ends this process
+    AppSettings::PendingSwitch pendingSwitch{switchingMode, clickTime, QDateTime::currentDateTime(), {}};
     if (optimusSettings.isAutoLogoutEnabled())
-        logout();
-    else
+        pendingSwitch.logoutTime = QDateTime::currentDateTime();
+    appSettings.setPendingSwitch(pendingSwitch);
+
+    journal.beginPhase(QStringLiteral("logout"));
+    if (optimusSettings.isAutoLogoutEnabled()) {
+        const QString logoutMethod = logout();
+        journal.setLogoutMethod(logoutMethod);
+        if (logoutMethod.isEmpty()) {
+            pendingSwitch.logoutTime = {};
+            appSettings.setPendingSwitch(pendingSwitch);
+        }
+    } else
         showNotification(tr("Configuration successfully applied"), tr("Your GPU will be switched after next login."));
+
+    MemoryReclaim::reclaim();
+}
+
+// Returns speculative preflight results if they are still valid or runs the checks now
+OptimusManager::PreflightResults OptimusManager::takePreflight()
+{
+    if (m_preflightThread != nullptr)
+        finishPreflight();
+
+    if (!m_preflightAge.isValid() || m_preflightAge.hasExpired(s_preflightValidity))
+        m_preflight = runPreflight(scannedGpuNodes());
+
+    // Switching can change checked state, so results are used only once
+    m_preflightAge.invalidate();
+    return m_preflight;
+}
+
+// In Nvidia mode the whole desktop is rendered on the discrete GPU and will be closed by logout
+QByteArrayList OptimusManager::scannedGpuNodes() const
+{
+    if (m_currentMode != OptimusSettings::Hybrid)
+        return {};
+
+    return GpuProcessScanner::discreteGpuNodes(m_gpuTopology->discreteGpu());
 }
 
-OptimusSettings::Mode OptimusManager::detectGpu()
+OptimusManager::PreflightResults OptimusManager::runPreflight(const QByteArrayList &gpuNodes)
 {
-    QFile stateFile(QStringLiteral("/var/lib/optimus-manager/tmp/state.json"));
-    if (!stateFile.open(QIODevice::ReadOnly))
-        qFatal("Unable to open Optimus Manager state file");
+    const TraceScope trace("runPreflight");
+    PreflightResults results;
+    results.existingPaths = PathProbe::exists(QStringList{SystemPaths::runitServiceFile(), SystemPaths::xorgConfigFile(), SystemPaths::mhwdConfigFile(),
+                                                          SystemPaths::xorgDriverFile(QStringLiteral("intel")), SystemPaths::xorgDriverFile(QStringLiteral("amdgpu"))}
+                                              + SystemPaths::gdmPrimeDirs());
+    results.daemonActive = isServiceActive(QStringLiteral("optimus-manager.service"));
+    results.bumblebeeActive = isServiceActive(QStringLiteral("bumblebeed.service"));
+    results.bbswitchAvailable = isModuleAvailable(QStringLiteral("bbswitch"));
+    results.nvidiaAvailable = isModuleAvailable(QStringLiteral("nvidia"));
+    results.displayManager = currentDisplayManager();
+    results.sessions = activeSessions();
+    results.sessionTypes = sessionTypes(results.sessions);
+    results.gpuProcesses = GpuProcessScanner::processesUsing(gpuNodes);
+    return results;
+}
+
+// Returns nullopt if the state is not written yet
+std::optional<OptimusSettings::Mode> OptimusManager::detectGpu()
+{
+    QFile stateFile(SystemPaths::stateFile());
+    if (!stateFile.open(QIODevice::ReadOnly)) {
+        qWarning("Unable to open Optimus Manager state file: %s", qPrintable(stateFile.errorString()));
+        return std::nullopt;
+    }
 
     QJsonParseError jsonError = {};
     const QJsonDocument jsonDocument = QJsonDocument::fromJson(stateFile.readAll(), &jsonError);
-    if (jsonError.error != QJsonParseError::NoError)
-        qFatal("Unable to parse Optimus Manager state file: %s", qPrintable(jsonError.errorString()));
+    if (jsonError.error != QJsonParseError::NoError) {
+        qWarning("Unable to parse Optimus Manager state file: %s", qPrintable(jsonError.errorString()));
+        return std::nullopt;
+    }
 
     QJsonValue modeValue = jsonDocument.object().value("current_mode");
-    if (modeValue.type() != QJsonValue::String)
-        qFatal("Unable to read current mode from Optimus Manager state file");
+    if (modeValue.type() != QJsonValue::String) {
+        qWarning("Unable to read current mode from Optimus Manager state file");
+        return std::nullopt;
+    }
 
     const QString currentMode = modeValue.toString();
     if (currentMode == QLatin1String("integrated"))
@@ -392,60 +856,76 @@ OptimusSettings::Mode OptimusManager::detectGpu()
     if (currentMode == QLatin1String("hybrid"))
         return OptimusSettings::Hybrid;
 
-    qFatal("Unknown GPU mode: %s", qPrintable(currentMode));
+    qWarning("Unknown GPU mode: %s", qPrintable(currentMode));
+    return std::nullopt;
 }
 
 bool OptimusManager::isModuleAvailable(const QString &moduleName)
 {
-    QFile modulesFile(QStringLiteral("/lib/modules/%1/modules.dep").arg(QSysInfo::kernelVersion()));
-    if (!modulesFile.open(QIODevice::ReadOnly))
-        return false;
-
-    while (!modulesFile.atEnd()) {
-        const QByteArray moduleInfo = modulesFile.readLine().trimmed();
-        if (moduleInfo.startsWith('#')) // Ignore comment lines
-            continue;
-
-        if (QFileInfo(moduleInfo.left(moduleInfo.indexOf(':'))).baseName() == moduleName)
-            return true;
-    }
+    const TraceScope trace("isModuleAvailable", moduleName);
+    const QString modulesPath = SystemPaths::modulesDepFile(QSysInfo::kernelVersion());
+    return SystemFactsCache::instance().value(QStringLiteral("module/") + moduleName, modulesPath, [&moduleName, &modulesPath] {
+        QFile modulesFile(modulesPath);
+        if (!modulesFile.open(QIODevice::ReadOnly))
+            return false;
+
+        while (!modulesFile.atEnd()) {
+            const QByteArray moduleInfo = modulesFile.readLine().trimmed();
+            if (moduleInfo.startsWith('#')) // Ignore comment lines
+                continue;
+
+            if (QFileInfo(moduleInfo.left(moduleInfo.indexOf(':'))).baseName() == moduleName)
+                return true;
+        }
 
-    return false;
+        return false;
+    }).toBool();
 }
 
 bool OptimusManager::isServiceActive(const QString &serviceName)
 {
-    QDBusInterface systemd(QStringLiteral("org.freedesktop.systemd1"), QStringLiteral("/org/freedesktop/systemd1"),
-                           QStringLiteral("org.freedesktop.systemd1.Manager"), QDBusConnection::systemBus());
-
-    const auto optimusManagerPath = systemd.call(QStringLiteral("GetUnit"), serviceName).arguments().at(0).value<QDBusObjectPath>();
-    if (optimusManagerPath.path().isEmpty())
+    const TraceScope trace("isServiceActive", serviceName);
+    QDBusMessage getUnit = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.systemd1"), QStringLiteral("/org/freedesktop/systemd1"),
+                                                          QStringLiteral("org.freedesktop.systemd1.Manager"), QStringLiteral("GetUnit"));
+    getUnit << serviceName;
+    const QDBusReply<QDBusObjectPath> unitPath = QDBusConnection::systemBus().call(getUnit);
+    if (!unitPath.isValid() || unitPath.value().path().isEmpty())
         return false;
 
-    const QDBusInterface optimusManager(QStringLiteral("org.freedesktop.systemd1"), optimusManagerPath.path(),
-                                        QStringLiteral("org.freedesktop.systemd1.Unit"), QDBusConnection::systemBus());
-    return optimusManager.property("SubState").toString() == QLatin1String("running");
+    const QDBusMessage subStateRequest = propertyRequest(QStringLiteral("org.freedesktop.systemd1"), unitPath.value().path(),
+                                                         QStringLiteral("org.freedesktop.systemd1.Unit"), QStringLiteral("SubState"));
+    const QDBusReply<QDBusVariant> subState = QDBusConnection::systemBus().call(subStateRequest);
+    return subState.isValid() && subState.value().variant().toString() == QLatin1String("running");
 }
 
-bool OptimusManager::isGdmPatched()
+bool OptimusManager::isGdmPatched(const QHash<QString, bool> &existingPaths)
 {
-    return QFileInfo::exists(QStringLiteral("/etc/gdm/Prime")) || QFileInfo::exists(QStringLiteral("/etc/gdm3/Prime"));
+    const QStringList primeDirs = SystemPaths::gdmPrimeDirs();
+    return std::any_of(primeDirs.cbegin(), primeDirs.cend(), [&existingPaths](const QString &dir) { return existingPaths.value(dir); });
 }
 
 QString OptimusManager::currentDisplayManager()
 {
-    const QSettings displayManager(QStringLiteral("/etc/systemd/system/display-manager.service"), QSettings::IniFormat);
-    return displayManager.value(QStringLiteral("Service/ExecStart")).toString();
+    const TraceScope trace("currentDisplayManager");
+    const QString servicePath = SystemPaths::displayManagerServiceFile();
+    return SystemFactsCache::instance().value(QStringLiteral("displayManager"), servicePath, [&servicePath] {
+        const QSettings displayManager(servicePath, QSettings::IniFormat);
+        return displayManager.value(QStringLiteral("Service/ExecStart"));
+    }).toString();
 }
 
 QVector<Session> OptimusManager::activeSessions()
 {
+    const TraceScope trace("activeSessions");
     // Get list of sessions
-    QDBusInterface logind(QStringLiteral("org.freedesktop.login1"), QStringLiteral("/org/freedesktop/login1"),
-                          QStringLiteral("org.freedesktop.login1.Manager"), QDBusConnection::systemBus());
-    const auto sessionList = logind.call(QStringLiteral("ListSessions")).arguments().at(0).value<QDBusArgument>();
+    const QDBusMessage listSessions = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.login1"), QStringLiteral("/org/freedesktop/login1"),
+                                                                     QStringLiteral("org.freedesktop.login1.Manager"), QStringLiteral("ListSessions"));
+    const QDBusMessage reply = QDBusConnection::systemBus().call(listSessions);
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty())
+        return {};
 
     // Demarshall data
+    const auto sessionList = reply.arguments().constFirst().value<QDBusArgument>();
     QVector<Session> activeSessions;
     sessionList.beginArray();
     while (!sessionList.atEnd()) {
@@ -460,6 +940,86 @@ QVector<Session> OptimusManager::activeSessions()
     return activeSessions;
 }
 
+// Show modal message and record how long it waited for the user
+int OptimusManager::execMessage(QMessageBox &message)
+{
+    const TraceScope trace("execMessage", [&message] { return message.text(); });
+    return execDialog(message);
+}
+
+int OptimusManager::execDialog(QDialog &dialog)
+{
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+    const int answer = dialog.exec();
+    if (SwitchJournal::Recorder *recorder = SwitchJournal::Recorder::current(); recorder != nullptr)
+        recorder->addDecisionWait(waitTimer.nsecsElapsed() / 1000);
+    return answer;
+}
+
+// Nothing is selected by default, so continuing without a choice closes nothing
+QVector<GpuProcess> OptimusManager::selectProcessesToClose(const QVector<GpuProcess> &processes, bool &cancelled)
+{
+    QDialog dialog;
+    dialog.setWindowTitle(QCoreApplication::applicationName());
+
+    auto *label = new QLabel(tr("Applications are using the discrete GPU and can prevent it from being switched off.\n"
+                                "Select applications to close before switching:"),
+                             &dialog);
+
+    auto *processList = new QListWidget(&dialog);
+    for (const GpuProcess &process : processes) {
+        auto *item = new QListWidgetItem(QStringLiteral("%1 (%2)").arg(process.name).arg(process.pid), processList);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Unchecked);
+    }
+
+    auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    buttonBox->button(QDialogButtonBox::Ok)->setText(tr("Continue"));
+    buttonBox->button(QDialogButtonBox::Ok)->setDefault(true);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    auto *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(label);
+    layout->addWidget(processList);
+    layout->addWidget(buttonBox);
+
+    cancelled = execDialog(dialog) != QDialog::Accepted;
+    QVector<GpuProcess> selectedProcesses;
+    if (cancelled)
+        return selectedProcesses;
+
+    for (int i = 0; i < processList->count(); ++i) {
+        if (processList->item(i)->checkState() == Qt::Checked)
+            selectedProcesses.append(processes.at(i));
+    }
+    return selectedProcesses;
+}
+
+// Request types of all sessions at once to avoid waiting for each reply in turn
+QStringList OptimusManager::sessionTypes(const QVector<Session> &sessions)
+{
+    const TraceScope trace("sessionTypes");
+    QVector<QDBusPendingCall> pendingCalls;
+    pendingCalls.reserve(sessions.size());
+    for (const Session &session : sessions) {
+        const QDBusMessage typeRequest = propertyRequest(QStringLiteral("org.freedesktop.login1"), session.sessionObjectPath.path(),
+                                                         QStringLiteral("org.freedesktop.login1.Session"), QStringLiteral("Type"));
+        pendingCalls.append(QDBusConnection::systemBus().asyncCall(typeRequest));
+    }
+
+    QStringList types;
+    types.reserve(sessions.size());
+    for (const QDBusPendingCall &pendingCall : qAsConst(pendingCalls)) {
+        QDBusPendingReply<QDBusVariant> type = pendingCall;
+        type.waitForFinished();
+        types.append(type.isValid() ? type.value().variant().toString() : QString());
+    }
+
+    return types;
+}
+
 // Return number of sessions, ignore gdm user
 int OptimusManager::sessionsCountWithoutGdm(const QVector<Session> &sessions)
 {
@@ -474,50 +1034,72 @@ int OptimusManager::sessionsCountWithoutGdm(const QVector<Session> &sessions)
     return sessionCount;
 }
 
-void OptimusManager::logout()
+// Returns used logout method or empty string if none succeeded
+QString OptimusManager::logout()
 {
-    QDBusInterface kde(QStringLiteral("org.kde.ksmserver"), QStringLiteral("/KSMServer"), QStringLiteral("org.kde.KSMServerInterface"));
-    if (kde.call(QStringLiteral("logout"), 0, 3, 3).type() == QDBusMessage::ReplyMessage)
-        return;
+    const TraceScope trace("logout");
+    if (callSessionManager(QStringLiteral("org.kde.ksmserver"), QStringLiteral("/KSMServer"), QStringLiteral("org.kde.KSMServerInterface"),
+                           QStringLiteral("logout"), {0, 3, 3}))
+        return QStringLiteral("org.kde.ksmserver");
 
-    QDBusInterface gnome(QStringLiteral("org.gnome.SessionManager"), QStringLiteral("/org/gnome/SessionManager"), QStringLiteral("org.gnome.SessionManager"));
-    if (gnome.call(QStringLiteral("Logout"), 1U).type() == QDBusMessage::ReplyMessage)
-        return;
+    if (callSessionManager(QStringLiteral("org.gnome.SessionManager"), QStringLiteral("/org/gnome/SessionManager"), QStringLiteral("org.gnome.SessionManager"),
+                           QStringLiteral("Logout"), {1U}))
+        return QStringLiteral("org.gnome.SessionManager");
 
-    QDBusInterface xfce(QStringLiteral("org.xfce.SessionManager"), QStringLiteral("/org/xfce/SessionManager"), QStringLiteral("org.xfce.Session.Manager"));
-    if (xfce.call(QStringLiteral("Logout"), false, true).type() == QDBusMessage::ReplyMessage)
-        return;
+    if (callSessionManager(QStringLiteral("org.xfce.SessionManager"), QStringLiteral("/org/xfce/SessionManager"), QStringLiteral("org.xfce.Session.Manager"),
+                           QStringLiteral("Logout"), {false, true}))
+        return QStringLiteral("org.xfce.SessionManager");
+
+    if (callSessionManager(QStringLiteral("com.deepin.SessionManager"), QStringLiteral("/com/deepin/SessionManager"), QStringLiteral("com.deepin.SessionManager"),
+                           QStringLiteral("RequestLogout"), {}))
+        return QStringLiteral("com.deepin.SessionManager");
 
-    QDBusInterface deepin(QStringLiteral("com.deepin.SessionManager"), QStringLiteral("/com/deepin/SessionManager"), QStringLiteral("com.deepin.SessionManager"));
-    if (deepin.call(QStringLiteral("RequestLogout")).type() == QDBusMessage::ReplyMessage)
-        return;
-    
     if (QProcess::execute(QStringLiteral("pkill"), {QStringLiteral("-SIGTERM"),QStringLiteral("lxsession")}) == 0)
-        return;
+        return QStringLiteral("lxsession");
     
     if (QProcess::execute(QStringLiteral("i3-msg"), {QStringLiteral("exit")}) == 0)
-        return;
+        return QStringLiteral("i3-msg");
 
     if (QProcess::execute(QStringLiteral("sway-msg"), {QStringLiteral("exit")}) == 0)
-        return;
+        return QStringLiteral("sway-msg");
 
     if (QProcess::execute(QStringLiteral("openbox"), {QStringLiteral("--exit")}) == 0)
-        return;
+        return QStringLiteral("openbox");
 
     if (QProcess::execute(QStringLiteral("awesome-client"), {QStringLiteral("awesome.quit()")}) == 0)
-        return;
+        return QStringLiteral("awesome-client");
 
     if (QProcess::execute(QStringLiteral("bspc"), {QStringLiteral("quit")}) == 0)
-        return;
+        return QStringLiteral("bspc");
+
+    if (killProcess("/usr/bin/dwm") || killProcess("/usr/local/bin/dwm"))
+        return QStringLiteral("dwm");
+    if (killProcess("/usr/bin/qtile-cmd -o cmd -f shutdown"))
+        return QStringLiteral("qtile");
+
+    return {};
+}
+
+bool OptimusManager::callSessionManager(const QString &service, const QString &path, const QString &interface, const QString &method, const QVariantList &arguments)
+{
+    const TraceScope trace("callSessionManager", service);
+    QDBusMessage call = QDBusMessage::createMethodCall(service, path, interface, method);
+    call.setArguments(arguments);
+    return QDBusConnection::sessionBus().call(call).type() == QDBusMessage::ReplyMessage;
+}
 
-    killProcess("/usr/bin/dwm");
-    killProcess("/usr/local/bin/dwm");
-    killProcess("/usr/bin/qtile-cmd -o cmd -f shutdown");
+// Create org.freedesktop.DBus.Properties.Get call without introspecting the remote object like QDBusInterface does
+QDBusMessage OptimusManager::propertyRequest(const QString &service, const QString &path, const QString &interface, const QString &name)
+{
+    QDBusMessage request = QDBusMessage::createMethodCall(service, path, QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("Get"));
+    request << interface << name;
+    return request;
 }
 
 bool OptimusManager::killProcess(const QByteArray &name)
 {
-    for (QDirIterator it(QStringLiteral("/proc"), QDir::NoDotAndDotDot | QDir::Dirs); it.hasNext();) {
+    const TraceScope trace("killProcess", [&name] { return QString::fromLocal8Bit(name); });
+    for (QDirIterator it(SystemPaths::procDir(), QDir::NoDotAndDotDot | QDir::Dirs); it.hasNext();) {
         const QDir process = it.next();
 
         bool isNumber;
@@ -536,3 +1118,37 @@ bool OptimusManager::killProcess(const QByteArray &name)
 
     return false;
 }
+
+OptimusManagerAdaptor::OptimusManagerAdaptor(OptimusManager *manager)
+    : QDBusAbstractAdaptor(manager)
+    , m_manager(manager)
+{
+}
+
+QString OptimusManagerAdaptor::serviceName()
+{
+    return QStringLiteral("io.optimus_manager.OptimusManagerQt");
+}
+
+QString OptimusManagerAdaptor::objectPath()
+{
+    return QStringLiteral("/OptimusManagerQt");
+}
+
+void OptimusManagerAdaptor::SwitchMode(const QString &mode, const QDBusMessage &message)
+{
+    const OptimusSettings::Mode switchingMode = OptimusSettings::modeFromString(mode, OptimusSettings::Auto);
+    if (switchingMode == OptimusSettings::Auto) {
+        message.setDelayedReply(true);
+        QDBusConnection::sessionBus().send(message.createErrorReply(QDBusError::InvalidArgs, QStringLiteral("Unknown GPU mode: %1").arg(mode)));
+        return;
+    }
+
+    QMetaObject::invokeMethod(
+        m_manager, [manager = m_manager, switchingMode] { manager->switchMode(switchingMode); }, Qt::QueuedConnection);
+}
+
+void OptimusManagerAdaptor::OpenSettings()
+{
+    QMetaObject::invokeMethod(m_manager, &OptimusManager::openSettings, Qt::QueuedConnection);
+}
@@ -20,14 +20,31 @@
 #ifndef OPTIMUSMANAGER_H
 #define OPTIMUSMANAGER_H
 
+#include "gpuprocessscanner.h"
+#include "session.h"
 #include "settings/appsettings.h"
 #include "settings/optimussettings.h"
 
-class Session;
+#include <QDBusAbstractAdaptor>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <optional>
+
+class GpuTopology;
+class PowerPolicy;
+class PowerSampler;
+class QFileSystemWatcher;
+class QThread;
+class QDBusMessage;
 class QMenu;
+class QDialog;
+class QMessageBox;
 class QAction;
-#ifdef WITH_PLASMA
+#if defined(WITH_PLASMA)
 class KStatusNotifierItem;
+#elif defined(WITH_NATIVE_SNI)
+class StatusNotifierItem;
 #else
 class QSystemTrayIcon;
 #endif
@@ -38,29 +55,68 @@ class OptimusManager : public QObject
     Q_DISABLE_COPY(OptimusManager)
 
 public:
+    // Side-effect free checks, can be run in background
+    struct PreflightResults {
+        QHash<QString, bool> existingPaths;
+        bool daemonActive = false;
+        bool bumblebeeActive = false;
+        bool bbswitchAvailable = false;
+        bool nvidiaAvailable = false;
+        QString displayManager;
+        QVector<Session> sessions;
+        QStringList sessionTypes;
+        QVector<GpuProcess> gpuProcesses; // Scanned only for the passed nodes
+    };
+
     explicit OptimusManager(QObject *parent = nullptr);
     ~OptimusManager() override;
 
+    void switchMode(OptimusSettings::Mode switchingMode);
+
+    static std::optional<OptimusSettings::Mode> detectGpu();
+    static PreflightResults runPreflight(const QByteArrayList &gpuNodes);
+
+public slots:
+    void openSettings();
+
 private slots:
     void switchToIntegrated();
     void switchToNvidia();
     void switchToHybrid();
-    void openSettings();
+    void startPreflight();
+    void finishPreflight();
+    void updateCurrentMode();
+    void runOffloadCommand();
 
 private:
     void showNotification(const QString &title, const QString &message);
     void loadSettings(AppSettings &settings);
+    void updateTrayIcon(AppSettings &settings);
+    void watchStateFile();
     void retranslateUi();
-    void switchMode(OptimusSettings::Mode switchingMode);
+    void updateToolTip();
+    void updateProfilesMenu();
+    void applyProfile(const AppSettings::ConfigProfile &profile);
+    void updateOffloadMenu();
+    void launchOffloaded(const QString &command);
+    void checkPendingSwitch();
+    PreflightResults takePreflight();
+    QByteArrayList scannedGpuNodes() const;
+
+    static int execMessage(QMessageBox &message);
+    static int execDialog(QDialog &dialog);
+    static QVector<GpuProcess> selectProcessesToClose(const QVector<GpuProcess> &processes, bool &cancelled);
 
-    static OptimusSettings::Mode detectGpu();
     static bool isModuleAvailable(const QString &moduleName);
     static bool isServiceActive(const QString &serviceName);
-    static bool isGdmPatched();
+    static bool isGdmPatched(const QHash<QString, bool> &existingPaths);
     static QString currentDisplayManager();
     static QVector<Session> activeSessions();
+    static QStringList sessionTypes(const QVector<Session> &sessions);
     static int sessionsCountWithoutGdm(const QVector<Session> &sessions);
-    static void logout();
+    static QString logout();
+    static bool callSessionManager(const QString &service, const QString &path, const QString &interface, const QString &method, const QVariantList &arguments);
+    static QDBusMessage propertyRequest(const QString &service, const QString &path, const QString &interface, const QString &name);
     static bool killProcess(const QByteArray &name);
 
     QMenu *m_contextMenu;
@@ -68,13 +124,49 @@ private:
     QAction *m_switchToIntegratedAction;
     QAction *m_switchToNvidiaAction;
     QAction *m_switchToHybridAction;
+    QMenu *m_profilesMenu;
+    QMenu *m_offloadMenu;
     QAction *m_exitAction;
-#ifdef WITH_PLASMA
+#if defined(WITH_PLASMA)
     KStatusNotifierItem *m_trayIcon;
+#elif defined(WITH_NATIVE_SNI)
+    StatusNotifierItem *m_trayIcon;
 #else
     QSystemTrayIcon *m_trayIcon;
 #endif
-    OptimusSettings::Mode m_currentMode;
+    GpuTopology *m_gpuTopology;
+    PowerSampler *m_powerSampler;
+    PowerPolicy *m_powerPolicy = nullptr; // Created only when enabled
+    std::optional<OptimusSettings::Mode> m_currentMode; // Unknown until the daemon writes its state
+    QFileSystemWatcher *m_stateWatcher = nullptr;
+
+    // Started when the menu is shown to have results ready when a switch is clicked
+    QThread *m_preflightThread = nullptr;
+    PreflightResults m_threadPreflight; // Written only by the running thread
+    PreflightResults m_preflight;
+    QElapsedTimer m_preflightAge;
+};
+
+// Commands forwarded by other launches of the application.
+// Replies are sent immediately, commands are executed later since they can show dialogs.
+class OptimusManagerAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "io.optimus_manager.OptimusManagerQt")
+    Q_DISABLE_COPY(OptimusManagerAdaptor)
+
+public:
+    explicit OptimusManagerAdaptor(OptimusManager *manager);
+
+    static QString serviceName();
+    static QString objectPath();
+
+public slots:
+    void SwitchMode(const QString &mode, const QDBusMessage &message);
+    void OpenSettings();
+
+private:
+    OptimusManager *m_manager;
 };
 
 #endif // OPTIMUSMANAGER_H
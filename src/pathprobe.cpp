@@ -0,0 +1,92 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pathprobe.h"
+
+#include "tracescope.h"
+
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVector>
+
+namespace
+{
+// Paths are few and the checks only wait on the filesystem
+constexpr int maxProbeThreads = 4;
+
+class ExistenceCheck : public QRunnable
+{
+public:
+    ExistenceCheck(const QString &path, bool *result, QSemaphore *done)
+        : m_path(path)
+        , m_result(result)
+        , m_done(done)
+    {
+    }
+
+    void run() override
+    {
+        *m_result = QFileInfo::exists(m_path);
+        m_done->release();
+    }
+
+private:
+    const QString m_path;
+    bool *m_result;
+    QSemaphore *m_done;
+};
+
+// Shared between calls, so threads are reused instead of created on every probe
+class ProbePool : public QThreadPool
+{
+public:
+    ProbePool()
+    {
+        setMaxThreadCount(maxProbeThreads);
+    }
+};
+}
+
+QHash<QString, bool> PathProbe::exists(const QStringList &paths)
+{
+    const TraceScope trace("PathProbe::exists", [&paths] { return paths.join(' '); });
+
+    QHash<QString, bool> existingPaths;
+    existingPaths.reserve(paths.size());
+    if (paths.isEmpty())
+        return existingPaths;
+
+    // Waits only for own checks, the pool may be used by another thread at the same time
+    QVector<bool> results(paths.size());
+    QSemaphore done;
+    static ProbePool pool;
+    for (int i = 1; i < paths.size(); ++i)
+        pool.start(new ExistenceCheck(paths[i], &results[i], &done));
+
+    // The calling thread would be idle anyway, so it checks the first path itself
+    results[0] = QFileInfo::exists(paths.constFirst());
+    done.acquire(paths.size() - 1);
+
+    for (int i = 0; i < paths.size(); ++i)
+        existingPaths.insert(paths[i], results[i]);
+
+    return existingPaths;
+}
@@ -0,0 +1,169 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "powerpolicy.h"
+
+#include "daemonclient.h"
+#include "switchjournal.h"
+#include "systempaths.h"
+#include "tracescope.h"
+#include "ueventmonitor.h"
+#include "settings/appsettings.h"
+
+#include <QDBusConnection>
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+
+namespace
+{
+QByteArray readAttribute(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+
+    return file.readAll().trimmed();
+}
+}
+
+PowerPolicy::PowerPolicy(std::optional<OptimusSettings::Mode> currentMode, QObject *parent)
+    : QObject(parent)
+    , m_ueventMonitor(new UeventMonitor(this))
+    , m_stageTimer(new QTimer(this))
+    , m_requestedMode(currentMode)
+{
+    m_stageTimer->setSingleShot(true);
+    connect(m_stageTimer, &QTimer::timeout, this, &PowerPolicy::stage);
+    connect(m_ueventMonitor, &UeventMonitor::ueventReceived, this, &PowerPolicy::onUeventReceived);
+    QDBusConnection::systemBus().connect(QStringLiteral("org.freedesktop.UPower"),
+                                         QStringLiteral("/org/freedesktop/UPower"),
+                                         QStringLiteral("org.freedesktop.DBus.Properties"),
+                                         QStringLiteral("PropertiesChanged"),
+                                         this,
+                                         SLOT(onUPowerPropertiesChanged(QString, QVariantMap, QStringList)));
+
+    m_onBattery = readOnBattery();
+}
+
+void PowerPolicy::setRequestedMode(OptimusSettings::Mode mode)
+{
+    m_requestedMode = mode;
+}
+
+void PowerPolicy::onUPowerPropertiesChanged(const QString &interface, const QVariantMap &changedProperties, const QStringList &invalidatedProperties)
+{
+    if (interface != QLatin1String("org.freedesktop.UPower"))
+        return;
+
+    if (const auto it = changedProperties.constFind(QStringLiteral("OnBattery")); it != changedProperties.cend()) {
+        setOnBattery(it->toBool());
+    } else if (invalidatedProperties.contains(QStringLiteral("OnBattery"))) {
+        if (const std::optional<bool> onBattery = readOnBattery(); onBattery)
+            setOnBattery(*onBattery);
+    }
+}
+
+void PowerPolicy::onUeventReceived(const QByteArray &, const QByteArray &subsystem)
+{
+    if (subsystem != "power_supply")
+        return;
+
+    if (const std::optional<bool> onBattery = readOnBattery(); onBattery)
+        setOnBattery(*onBattery);
+}
+
+void PowerPolicy::setOnBattery(bool onBattery)
+{
+    // Both sources report the same transition
+    if (m_onBattery == onBattery)
+        return;
+
+    // First known power source is not a transition
+    const bool wasKnown = m_onBattery.has_value();
+    m_onBattery = onBattery;
+    if (!wasKnown)
+        return;
+
+    if (m_lastStage.isValid() && !m_lastStage.hasExpired(s_stageInterval))
+        m_stageTimer->start(static_cast<int>(s_stageInterval - m_lastStage.elapsed()));
+    else
+        stage();
+}
+
+// Daemon picks the mode from the power source only at boot, so a switch is requested for the next login
+void PowerPolicy::stage()
+{
+    const TraceScope trace("PowerPolicy::stage");
+    m_stageTimer->stop();
+    m_lastStage.start();
+
+    // Explicit startup modes and switches requested by the user are not overridden
+    const OptimusSettings optimusSettings(OptimusSettings::detectConfigPath().first);
+    if (optimusSettings.startupMode() != OptimusSettings::Auto || AppSettings().pendingSwitch().clickTime.isValid())
+        return;
+
+    const OptimusSettings::Mode mode = *m_onBattery ? optimusSettings.batteryStartupMode() : optimusSettings.externalPowerStartupMode();
+    if (mode == m_requestedMode)
+        return;
+
+    SwitchJournal::Recorder journal(SwitchJournal::Switch, OptimusSettings::modeString(mode));
+    journal.beginPhase(QStringLiteral("daemonConnect"));
+    DaemonClient client;
+    client.connect();
+    if (client.error()) {
+        journal.setResult(SwitchJournal::Failed);
+        journal.setSendError(client.errorString());
+        qWarning("Unable to connect to Optimus Manager daemon: %s", qPrintable(client.errorString()));
+        return;
+    }
+
+    journal.beginPhase(QStringLiteral("daemonSend"));
+    client.setGpu(mode);
+    if (client.error()) {
+        journal.setResult(SwitchJournal::Failed);
+        journal.setSendError(client.errorString());
+        qWarning("Unable to send GPU switch to Optimus Manager daemon: %s", qPrintable(client.errorString()));
+        return;
+    }
+
+    m_requestedMode = mode;
+}
+
+// Returns nullopt if there is no mains power supply, like on desktops
+std::optional<bool> PowerPolicy::readOnBattery()
+{
+    const QDir powerSupplies(SystemPaths::resolve(QStringLiteral("/sys/class/power_supply")));
+    const QStringList supplies = powerSupplies.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    bool hasMains = false;
+    for (const QString &supply : supplies) {
+        const QDir supplyDir(powerSupplies.filePath(supply));
+        if (readAttribute(supplyDir.filePath(QStringLiteral("type"))) != "Mains")
+            continue;
+
+        hasMains = true;
+        if (readAttribute(supplyDir.filePath(QStringLiteral("online"))) == "1")
+            return false;
+    }
+
+    if (!hasMains)
+        return std::nullopt;
+
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef POWERPOLICY_H
+#define POWERPOLICY_H
+
+#include "settings/optimussettings.h"
+
+#include <QElapsedTimer>
+#include <QVariantMap>
+
+#include <optional>
+
+class QTimer;
+class UeventMonitor;
+
+// Requests the GPU mode for the current power source for the next login when startup mode is Auto.
+// Driven by UPower property changes and power supply uevents, no polling.
+// Only transitions are acted upon, the power source at construction is just remembered.
+class PowerPolicy : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PowerPolicy)
+
+public:
+    explicit PowerPolicy(std::optional<OptimusSettings::Mode> currentMode, QObject *parent = nullptr);
+
+    // Called when the mode of the next login becomes known from the daemon state or a user switch
+    void setRequestedMode(OptimusSettings::Mode mode);
+
+private slots:
+    void onUPowerPropertiesChanged(const QString &interface, const QVariantMap &changedProperties, const QStringList &invalidatedProperties);
+    void onUeventReceived(const QByteArray &action, const QByteArray &subsystem);
+    void stage();
+
+private:
+    void setOnBattery(bool onBattery);
+
+    static std::optional<bool> readOnBattery();
+
+    // Minimum time between two requests to ignore plug flapping
+    static constexpr qint64 s_stageInterval = 60000;
+
+    UeventMonitor *m_ueventMonitor;
+    QTimer *m_stageTimer;
+    QElapsedTimer m_lastStage;
+    std::optional<bool> m_onBattery;
+    std::optional<OptimusSettings::Mode> m_requestedMode; // Mode of the next login, unknown until the daemon state is read
+};
+
+#endif // POWERPOLICY_H
@@ -0,0 +1,222 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "powersampler.h"
+
+#include "gputopology.h"
+#include "systempaths.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+PowerSampler::PowerSampler(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    // Precision is not needed, so the wakeup can be merged with others
+    m_timer->setTimerType(Qt::VeryCoarseTimer);
+    m_timer->setInterval(s_intervalSeconds * 1000);
+    connect(m_timer, &QTimer::timeout, this, &PowerSampler::sample);
+
+    openBatteryFiles();
+    openGpuStatusFile();
+    if (const GpuTopology *topology = GpuTopology::instance(); topology != nullptr)
+        connect(topology, &GpuTopology::changed, this, &PowerSampler::openGpuStatusFile);
+}
+
+PowerSampler::~PowerSampler()
+{
+    closeFile(m_gpuStatusFd);
+    for (BatteryFiles &battery : m_batteries) {
+        closeFile(battery.powerFd);
+        closeFile(battery.currentFd);
+        closeFile(battery.voltageFd);
+    }
+}
+
+bool PowerSampler::isAvailable() const
+{
+    return m_batteryCount != 0 || m_gpuStatusFd != -1;
+}
+
+qint64 PowerSampler::averagePower() const
+{
+    qint64 sum = 0;
+    int count = 0;
+    for (int i = 0; i < m_sampleCount; ++i) {
+        if (m_samples[i].power > 0) {
+            sum += m_samples[i].power;
+            ++count;
+        }
+    }
+
+    if (count == 0)
+        return -1;
+
+    return sum / count / 1000;
+}
+
+PowerSampler::GpuPowerStatus PowerSampler::gpuPowerStatus() const
+{
+    if (m_sampleCount == 0)
+        return UnknownStatus;
+
+    const int lastSample = (m_nextSample + static_cast<int>(m_samples.size()) - 1) % static_cast<int>(m_samples.size());
+    return m_samples[lastSample].gpuStatus;
+}
+
+void PowerSampler::sample()
+{
+    Sample &sample = m_samples[m_nextSample];
+    sample.power = readPower();
+    sample.gpuStatus = readGpuStatus();
+
+    m_nextSample = (m_nextSample + 1) % static_cast<int>(m_samples.size());
+    if (m_sampleCount < static_cast<int>(m_samples.size()))
+        ++m_sampleCount;
+
+    const qint64 power = averagePower();
+    const qint64 reportedPower = power == -1 ? -1 : (power + 50) / 100;
+    if (reportedPower == m_reportedPower && sample.gpuStatus == m_reportedStatus)
+        return;
+
+    m_reportedPower = reportedPower;
+    m_reportedStatus = sample.gpuStatus;
+    emit changed();
+}
+
+void PowerSampler::openBatteryFiles()
+{
+    const QDir powerSupplies(SystemPaths::resolve(QStringLiteral("/sys/class/power_supply")));
+    const QStringList names = powerSupplies.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &name : names) {
+        if (m_batteryCount == s_maxBatteries)
+            break;
+
+        QFile type(powerSupplies.filePath(name + QStringLiteral("/type")));
+        if (!type.open(QIODevice::ReadOnly) || type.readAll().trimmed() != "Battery")
+            continue;
+
+        BatteryFiles &battery = m_batteries[m_batteryCount];
+        battery.powerFd = open(QFile::encodeName(powerSupplies.filePath(name + QStringLiteral("/power_now"))).constData(), O_RDONLY | O_CLOEXEC);
+        if (battery.powerFd == -1) {
+            // Some batteries report only current and voltage
+            battery.currentFd = open(QFile::encodeName(powerSupplies.filePath(name + QStringLiteral("/current_now"))).constData(), O_RDONLY | O_CLOEXEC);
+            battery.voltageFd = open(QFile::encodeName(powerSupplies.filePath(name + QStringLiteral("/voltage_now"))).constData(), O_RDONLY | O_CLOEXEC);
+            if (battery.currentFd == -1 || battery.voltageFd == -1) {
+                closeFile(battery.currentFd);
+                closeFile(battery.voltageFd);
+                continue;
+            }
+        }
+
+        ++m_batteryCount;
+    }
+}
+
+void PowerSampler::openGpuStatusFile()
+{
+    closeFile(m_gpuStatusFd);
+
+    const GpuTopology *topology = GpuTopology::instance();
+    if (topology == nullptr)
+        return;
+
+    if (const GpuDevice *gpu = topology->discreteGpu(); gpu != nullptr) {
+        const QString statusPath = SystemPaths::resolve(QStringLiteral("/sys/bus/pci/devices/%1/power/runtime_status").arg(gpu->address));
+        m_gpuStatusFd = open(QFile::encodeName(statusPath).constData(), O_RDONLY | O_CLOEXEC);
+    }
+
+    updateTimer();
+}
+
+// Started when a GPU appears without batteries, stopped when nothing is left to sample
+void PowerSampler::updateTimer()
+{
+    if (!isAvailable()) {
+        m_timer->stop();
+        return;
+    }
+
+    if (m_timer->isActive())
+        return;
+
+    m_timer->start();
+    sample();
+}
+
+qint64 PowerSampler::readPower() const
+{
+    qint64 power = 0;
+    for (int i = 0; i < m_batteryCount; ++i) {
+        const BatteryFiles &battery = m_batteries[i];
+        if (battery.powerFd != -1) {
+            power += readNumber(battery.powerFd);
+        } else {
+            // Both values are in micro-units, so the product is in picowatts
+            power += readNumber(battery.currentFd) * readNumber(battery.voltageFd) / 1000000;
+        }
+    }
+
+    return power;
+}
+
+PowerSampler::GpuPowerStatus PowerSampler::readGpuStatus() const
+{
+    if (m_gpuStatusFd == -1)
+        return UnknownStatus;
+
+    char buffer[16];
+    const ssize_t size = pread(m_gpuStatusFd, buffer, sizeof(buffer), 0);
+    if (size <= 0)
+        return UnknownStatus;
+
+    const QLatin1String status(buffer, static_cast<int>(size));
+    if (status.startsWith(QLatin1String("active")))
+        return Active;
+    if (status.startsWith(QLatin1String("suspended")))
+        return Suspended;
+
+    return UnknownStatus;
+}
+
+qint64 PowerSampler::readNumber(int fd)
+{
+    char buffer[32];
+    const ssize_t size = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (size <= 0)
+        return 0;
+
+    buffer[size] = '\0';
+    return std::strtoll(buffer, nullptr, 10);
+}
+
+void PowerSampler::closeFile(int &fd)
+{
+    if (fd == -1)
+        return;
+
+    close(fd);
+    fd = -1;
+}
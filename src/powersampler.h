@@ -0,0 +1,98 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef POWERSAMPLER_H
+#define POWERSAMPLER_H
+
+#include <QObject>
+
+#include <array>
+
+class QTimer;
+
+// Periodically samples battery power draw and runtime power status of the discrete GPU.
+// Files are opened once and samples are stored in a preallocated ring buffer,
+// so sampling itself does not allocate. The timer runs only while something can be sampled.
+class PowerSampler : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PowerSampler)
+
+public:
+    enum GpuPowerStatus {
+        UnknownStatus,
+        Active,
+        Suspended
+    };
+
+    explicit PowerSampler(QObject *parent = nullptr);
+    ~PowerSampler() override;
+
+    bool isAvailable() const;
+
+    // Average power draw in milliwatts over the buffered samples, -1 if unknown
+    qint64 averagePower() const;
+    GpuPowerStatus gpuPowerStatus() const;
+
+signals:
+    // Emitted only when the average rounded to 0.1 W or the GPU status changes
+    void changed();
+
+private slots:
+    void sample();
+    void openGpuStatusFile();
+
+private:
+    struct Sample {
+        qint64 power = 0; // In microwatts
+        GpuPowerStatus gpuStatus = UnknownStatus;
+    };
+
+    struct BatteryFiles {
+        int powerFd = -1;
+        int currentFd = -1;
+        int voltageFd = -1;
+    };
+
+    void openBatteryFiles();
+    void updateTimer();
+
+    qint64 readPower() const;
+    GpuPowerStatus readGpuStatus() const;
+
+    static qint64 readNumber(int fd);
+    static void closeFile(int &fd);
+
+    static constexpr int s_intervalSeconds = 30;
+    static constexpr int s_maxBatteries = 4;
+
+    std::array<Sample, 20> m_samples; // Last 10 minutes
+    int m_nextSample = 0;
+    int m_sampleCount = 0;
+
+    std::array<BatteryFiles, s_maxBatteries> m_batteries;
+    int m_batteryCount = 0;
+    int m_gpuStatusFd = -1;
+
+    QTimer *m_timer;
+    qint64 m_reportedPower = -1; // In 0.1 W
+    GpuPowerStatus m_reportedStatus = UnknownStatus;
+};
+
+#endif // POWERSAMPLER_H
@@ -0,0 +1,52 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "renderoffload.h"
+
+#include "gputopology.h"
+#include "tracescope.h"
+
+#include <QProcess>
+
+QProcessEnvironment RenderOffload::environment(const GpuDevice *discreteGpu)
+{
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+
+    // Optimus Manager is mostly used with NVIDIA, so it is assumed if topology is not available
+    if (discreteGpu == nullptr || discreteGpu->vendor == GpuDevice::Nvidia) {
+        environment.insert(QStringLiteral("__NV_PRIME_RENDER_OFFLOAD"), QStringLiteral("1"));
+        environment.insert(QStringLiteral("__GLX_VENDOR_LIBRARY_NAME"), QStringLiteral("nvidia"));
+        environment.insert(QStringLiteral("__VK_LAYER_NV_optimus"), QStringLiteral("NVIDIA_only"));
+    } else {
+        environment.insert(QStringLiteral("DRI_PRIME"), QStringLiteral("1"));
+    }
+
+    return environment;
+}
+
+bool RenderOffload::launch(const QString &command, const QProcessEnvironment &environment)
+{
+    const TraceScope trace("RenderOffload::launch", command);
+    QProcess process;
+    process.setProgram(QStringLiteral("/bin/sh"));
+    process.setArguments({QStringLiteral("-c"), QStringLiteral("exec ") + command});
+    process.setProcessEnvironment(environment);
+    process.setStandardInputFile(QProcess::nullDevice());
+    return process.startDetached();
+}
@@ -0,0 +1,106 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "applicationpickerdialog.h"
+
+#include "desktopcatalog.h"
+
+#include <QDialogButtonBox>
+#include <QFileInfo>
+#include <QIcon>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+ApplicationPickerDialog::ApplicationPickerDialog(QWidget *parent)
+    : QDialog(parent)
+    , m_searchEdit(new QLineEdit(this))
+    , m_applicationsList(new QListWidget(this))
+{
+    setWindowTitle(tr("Select application"));
+    resize(450, 500);
+
+    m_searchEdit->setPlaceholderText(tr("Search applications"));
+    m_searchEdit->setClearButtonEnabled(true);
+    connect(m_searchEdit, &QLineEdit::textChanged, this, &ApplicationPickerDialog::search);
+
+    m_applicationsList->setUniformItemSizes(true);
+    m_applicationsList->setIconSize({32, 32});
+    connect(m_applicationsList, &QListWidget::itemActivated, this, &ApplicationPickerDialog::accept);
+
+    auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    QPushButton *enterCommandButton = buttonBox->addButton(tr("Enter command…"), QDialogButtonBox::ActionRole);
+    connect(enterCommandButton, &QPushButton::clicked, this, &ApplicationPickerDialog::enterCommand);
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &ApplicationPickerDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &ApplicationPickerDialog::reject);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(m_searchEdit);
+    layout->addWidget(m_applicationsList);
+    layout->addWidget(buttonBox);
+
+    // Catalog is updated in background if applications were installed since the last index
+    connect(DesktopCatalog::instance(), &DesktopCatalog::changed, this, [this] { search(m_searchEdit->text()); });
+    search({});
+}
+
+QString ApplicationPickerDialog::selectedName() const
+{
+    if (!m_enteredCommand.isEmpty())
+        return QFileInfo(m_enteredCommand.section(' ', 0, 0)).fileName();
+
+    const QListWidgetItem *item = m_applicationsList->currentItem();
+    return item != nullptr ? item->text() : QString();
+}
+
+QString ApplicationPickerDialog::selectedCommand() const
+{
+    if (!m_enteredCommand.isEmpty())
+        return m_enteredCommand;
+
+    const QListWidgetItem *item = m_applicationsList->currentItem();
+    return item != nullptr ? item->data(Qt::UserRole).toString() : QString();
+}
+
+void ApplicationPickerDialog::search(const QString &prefix)
+{
+    m_applicationsList->clear();
+
+    const QVector<DesktopCatalog::Entry> entries = DesktopCatalog::instance()->search(prefix.trimmed());
+    for (const DesktopCatalog::Entry &entry : entries) {
+        const QIcon icon = QFileInfo(entry.icon).isAbsolute() ? QIcon(entry.icon) : QIcon::fromTheme(entry.icon);
+        auto *item = new QListWidgetItem(icon, entry.name, m_applicationsList);
+        item->setData(Qt::UserRole, entry.exec);
+        item->setToolTip(entry.exec);
+    }
+    m_applicationsList->setCurrentRow(0);
+}
+
+void ApplicationPickerDialog::enterCommand()
+{
+    bool ok;
+    const QString command = QInputDialog::getText(this, tr("Enter command"), tr("Command:"), QLineEdit::Normal, {}, &ok).trimmed();
+    if (!ok || command.isEmpty())
+        return;
+
+    m_enteredCommand = command;
+    accept();
+}
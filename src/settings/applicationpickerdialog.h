@@ -0,0 +1,50 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef APPLICATIONPICKERDIALOG_H
+#define APPLICATIONPICKERDIALOG_H
+
+#include <QDialog>
+
+class QLineEdit;
+class QListWidget;
+
+// Installed applications with prefix search, also allows to enter a command
+class ApplicationPickerDialog : public QDialog
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ApplicationPickerDialog)
+
+public:
+    explicit ApplicationPickerDialog(QWidget *parent = nullptr);
+
+    QString selectedName() const;
+    QString selectedCommand() const;
+
+private slots:
+    void search(const QString &prefix);
+    void enterCommand();
+
+private:
+    QString m_enteredCommand;
+    QLineEdit *m_searchEdit;
+    QListWidget *m_applicationsList;
+};
+
+#endif // APPLICATIONPICKERDIALOG_H
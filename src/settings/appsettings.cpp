@@ -20,6 +20,7 @@
 #include "appsettings.h"
 
 #include "cmake.h"
+#include "iconresolver.h"
 
 #include <QDebug>
 #include <QDir>
@@ -93,9 +94,48 @@ bool AppSettings::defaultConfirmSwitching()
     return true;
 }
 
+QString AppSettings::metricsFilePath() const
+{
+    return m_settings->value(QStringLiteral("MetricsFile")).toString();
+}
+
+void AppSettings::setMetricsFilePath(const QString &path)
+{
+    m_settings->setValue(QStringLiteral("MetricsFile"), path);
+}
+
+bool AppSettings::isPowerPolicyEnabled() const
+{
+    return m_settings->value(QStringLiteral("PowerPolicyEnabled"), defaultPowerPolicyEnabled()).toBool();
+}
+
+void AppSettings::setPowerPolicyEnabled(bool enabled)
+{
+    m_settings->setValue(QStringLiteral("PowerPolicyEnabled"), enabled);
+}
+
+bool AppSettings::defaultPowerPolicyEnabled()
+{
+    return false;
+}
+
+int AppSettings::seenGpuVendors() const
+{
+    return m_settings->value(QStringLiteral("SeenGpuVendors"), 0).toInt();
+}
+
+void AppSettings::setSeenGpuVendors(int vendors)
+{
+    m_settings->setValue(QStringLiteral("SeenGpuVendors"), vendors);
+}
+
 QIcon AppSettings::modeIcon(OptimusSettings::Mode mode) const
 {
-    return QIcon::fromTheme(modeIconName(mode), QIcon::fromTheme(defaultModeIconName(mode)));
+    IconResolver *resolver = IconResolver::instance();
+    if (const QIcon icon = resolver->icon(modeIconName(mode)); !icon.isNull())
+        return icon;
+
+    return resolver->icon(defaultModeIconName(mode));
 }
 
 QString AppSettings::modeIconName(OptimusSettings::Mode mode) const
@@ -143,6 +183,123 @@ QString AppSettings::defaultModeIconName(OptimusSettings::Mode mode)
     }
 }
 
+AppSettings::PendingSwitch AppSettings::pendingSwitch() const
+{
+    PendingSwitch pendingSwitch;
+    pendingSwitch.mode = static_cast<OptimusSettings::Mode>(m_settings->value(QStringLiteral("PendingSwitch/Mode")).toInt());
+    pendingSwitch.clickTime = m_settings->value(QStringLiteral("PendingSwitch/ClickTime")).toDateTime();
+    pendingSwitch.sendTime = m_settings->value(QStringLiteral("PendingSwitch/SendTime")).toDateTime();
+    pendingSwitch.logoutTime = m_settings->value(QStringLiteral("PendingSwitch/LogoutTime")).toDateTime();
+    return pendingSwitch;
+}
+
+void AppSettings::setPendingSwitch(const PendingSwitch &pendingSwitch)
+{
+    m_settings->setValue(QStringLiteral("PendingSwitch/Mode"), pendingSwitch.mode);
+    m_settings->setValue(QStringLiteral("PendingSwitch/ClickTime"), pendingSwitch.clickTime);
+    m_settings->setValue(QStringLiteral("PendingSwitch/SendTime"), pendingSwitch.sendTime);
+    m_settings->setValue(QStringLiteral("PendingSwitch/LogoutTime"), pendingSwitch.logoutTime);
+}
+
+void AppSettings::removePendingSwitch()
+{
+    m_settings->remove(QStringLiteral("PendingSwitch"));
+}
+
+AppSettings::SwitchLatencyStats AppSettings::switchLatencyStats() const
+{
+    SwitchLatencyStats stats;
+    const QVariantList buckets = m_settings->value(QStringLiteral("SwitchLatency/Buckets")).toList();
+    for (const QVariant &bucket : buckets)
+        stats.buckets.append(bucket.toInt());
+    stats.sum = m_settings->value(QStringLiteral("SwitchLatency/Sum")).toLongLong();
+    stats.mismatches = m_settings->value(QStringLiteral("SwitchLatency/Mismatches")).toInt();
+    return stats;
+}
+
+void AppSettings::setSwitchLatencyStats(const SwitchLatencyStats &stats)
+{
+    QVariantList buckets;
+    for (int bucket : stats.buckets)
+        buckets.append(bucket);
+    m_settings->setValue(QStringLiteral("SwitchLatency/Buckets"), buckets);
+    m_settings->setValue(QStringLiteral("SwitchLatency/Sum"), stats.sum);
+    m_settings->setValue(QStringLiteral("SwitchLatency/Mismatches"), stats.mismatches);
+}
+
+AppSettings::SwitchMetrics AppSettings::switchMetrics() const
+{
+    SwitchMetrics metrics;
+    metrics.outcomes = m_settings->value(QStringLiteral("SwitchMetrics/Outcomes")).toMap();
+    metrics.sendErrors = m_settings->value(QStringLiteral("SwitchMetrics/SendErrors")).toInt();
+    const QVariantList buckets = m_settings->value(QStringLiteral("SwitchMetrics/PreflightBuckets")).toList();
+    for (const QVariant &bucket : buckets)
+        metrics.preflightBuckets.append(bucket.toInt());
+    metrics.preflightSum = m_settings->value(QStringLiteral("SwitchMetrics/PreflightSum")).toLongLong();
+    return metrics;
+}
+
+void AppSettings::setSwitchMetrics(const SwitchMetrics &metrics)
+{
+    QVariantList buckets;
+    for (int bucket : metrics.preflightBuckets)
+        buckets.append(bucket);
+    m_settings->setValue(QStringLiteral("SwitchMetrics/Outcomes"), metrics.outcomes);
+    m_settings->setValue(QStringLiteral("SwitchMetrics/SendErrors"), metrics.sendErrors);
+    m_settings->setValue(QStringLiteral("SwitchMetrics/PreflightBuckets"), buckets);
+    m_settings->setValue(QStringLiteral("SwitchMetrics/PreflightSum"), metrics.preflightSum);
+}
+
+QVector<AppSettings::ConfigProfile> AppSettings::configProfiles() const
+{
+    QVector<ConfigProfile> profiles;
+    const int size = m_settings->beginReadArray(QStringLiteral("ConfigProfiles"));
+    profiles.reserve(size);
+    for (int i = 0; i < size; ++i) {
+        m_settings->setArrayIndex(i);
+        profiles.append({m_settings->value(QStringLiteral("Name")).toString(), m_settings->value(QStringLiteral("Command")).toByteArray()});
+    }
+    m_settings->endArray();
+    return profiles;
+}
+
+void AppSettings::setConfigProfiles(const QVector<ConfigProfile> &profiles)
+{
+    m_settings->remove(QStringLiteral("ConfigProfiles"));
+    m_settings->beginWriteArray(QStringLiteral("ConfigProfiles"), profiles.size());
+    for (int i = 0; i < profiles.size(); ++i) {
+        m_settings->setArrayIndex(i);
+        m_settings->setValue(QStringLiteral("Name"), profiles.at(i).name);
+        m_settings->setValue(QStringLiteral("Command"), profiles.at(i).command);
+    }
+    m_settings->endArray();
+}
+
+QVector<AppSettings::OffloadRule> AppSettings::offloadRules() const
+{
+    QVector<OffloadRule> rules;
+    const int size = m_settings->beginReadArray(QStringLiteral("OffloadRules"));
+    rules.reserve(size);
+    for (int i = 0; i < size; ++i) {
+        m_settings->setArrayIndex(i);
+        rules.append({m_settings->value(QStringLiteral("Name")).toString(), m_settings->value(QStringLiteral("Command")).toString()});
+    }
+    m_settings->endArray();
+    return rules;
+}
+
+void AppSettings::setOffloadRules(const QVector<OffloadRule> &rules)
+{
+    m_settings->remove(QStringLiteral("OffloadRules"));
+    m_settings->beginWriteArray(QStringLiteral("OffloadRules"), rules.size());
+    for (int i = 0; i < rules.size(); ++i) {
+        m_settings->setArrayIndex(i);
+        m_settings->setValue(QStringLiteral("Name"), rules.at(i).name);
+        m_settings->setValue(QStringLiteral("Command"), rules.at(i).command);
+    }
+    m_settings->endArray();
+}
+
 void AppSettings::applyLocale(const QLocale &locale)
 {
     const QLocale newLocale = locale == defaultLocale() ? QLocale::system() : locale;
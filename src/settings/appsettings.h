@@ -22,7 +22,10 @@
 
 #include "optimussettings.h"
 
+#include <QDateTime>
 #include <QLocale>
+#include <QVariantMap>
+#include <QVector>
 
 class QTranslator;
 class QSettings;
@@ -50,11 +53,74 @@ public:
     void setConfirmSwitching(bool confirm);
     static bool defaultConfirmSwitching();
 
+    // Empty if metrics export is disabled
+    QString metricsFilePath() const;
+    void setMetricsFilePath(const QString &path);
+
+    bool isPowerPolicyEnabled() const;
+    void setPowerPolicyEnabled(bool enabled);
+    static bool defaultPowerPolicyEnabled();
+
+    // Bits of GpuDevice::Vendor values seen on this machine, discrete GPU can be removed from the bus in Integrated mode
+    int seenGpuVendors() const;
+    void setSeenGpuVendors(int vendors);
+
     QIcon modeIcon(OptimusSettings::Mode mode) const;
     QString modeIconName(OptimusSettings::Mode mode) const;
     void setModeIconName(OptimusSettings::Mode mode, const QString &name);
     static QString defaultModeIconName(OptimusSettings::Mode mode);
 
+    // Switch sent to the daemon that waits to be checked in the next session
+    struct PendingSwitch {
+        OptimusSettings::Mode mode = OptimusSettings::Integrated;
+        QDateTime clickTime; // Invalid if there is no pending switch
+        QDateTime sendTime;
+        QDateTime logoutTime; // Invalid if logout was not requested automatically
+    };
+
+    PendingSwitch pendingSwitch() const;
+    void setPendingSwitch(const PendingSwitch &pendingSwitch);
+    void removePendingSwitch();
+
+    // Accumulated click to new session latencies
+    struct SwitchLatencyStats {
+        QVector<int> buckets;
+        qint64 sum = 0; // Milliseconds
+        int mismatches = 0;
+    };
+
+    SwitchLatencyStats switchLatencyStats() const;
+    void setSwitchLatencyStats(const SwitchLatencyStats &stats);
+
+    // Accumulated counters for exported metrics
+    struct SwitchMetrics {
+        QVariantMap outcomes; // Counts by "operation/result"
+        int sendErrors = 0;
+        QVector<int> preflightBuckets;
+        qint64 preflightSum = 0; // Microseconds
+    };
+
+    SwitchMetrics switchMetrics() const;
+    void setSwitchMetrics(const SwitchMetrics &metrics);
+
+    // Named Optimus Manager configurations stored as ready to send daemon commands
+    struct ConfigProfile {
+        QString name;
+        QByteArray command;
+    };
+
+    QVector<ConfigProfile> configProfiles() const;
+    void setConfigProfiles(const QVector<ConfigProfile> &profiles);
+
+    // Applications always launched on the discrete GPU in Hybrid mode
+    struct OffloadRule {
+        QString name;
+        QString command;
+    };
+
+    QVector<OffloadRule> offloadRules() const;
+    void setOffloadRules(const QVector<OffloadRule> &rules);
+
 private:
     static void applyLocale(const QLocale &locale);
 
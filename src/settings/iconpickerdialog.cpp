@@ -0,0 +1,107 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "iconpickerdialog.h"
+
+#include "iconthumbnailmodel.h"
+
+#include <QDialogButtonBox>
+#include <QDir>
+#include <QFileDialog>
+#include <QIcon>
+#include <QLineEdit>
+#include <QListView>
+#include <QPushButton>
+#include <QSortFilterProxyModel>
+#include <QVBoxLayout>
+
+IconPickerDialog::IconPickerDialog(const QString &currentIcon, QWidget *parent)
+    : QDialog(parent)
+    , m_currentIcon(currentIcon)
+    , m_filterModel(new QSortFilterProxyModel(this))
+    , m_iconsView(new QListView(this))
+{
+    setWindowTitle(tr("Select icon"));
+    resize(700, 500);
+
+    m_filterModel->setSourceModel(new IconThumbnailModel(m_filterModel));
+    m_filterModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    m_filterModel->setSortCaseSensitivity(Qt::CaseInsensitive);
+    m_filterModel->sort(0);
+
+    auto *searchEdit = new QLineEdit(this);
+    searchEdit->setPlaceholderText(tr("Search icons"));
+    searchEdit->setClearButtonEnabled(true);
+    connect(searchEdit, &QLineEdit::textChanged, m_filterModel, &QSortFilterProxyModel::setFilterFixedString);
+
+    // Only visible items are laid out and painted, so big themes stay responsive
+    m_iconsView->setViewMode(QListView::IconMode);
+    m_iconsView->setUniformItemSizes(true);
+    m_iconsView->setLayoutMode(QListView::Batched);
+    m_iconsView->setResizeMode(QListView::Adjust);
+    m_iconsView->setMovement(QListView::Static);
+    m_iconsView->setWordWrap(true);
+    m_iconsView->setIconSize({IconThumbnailModel::thumbnailSize, IconThumbnailModel::thumbnailSize});
+    m_iconsView->setGridSize({IconThumbnailModel::thumbnailSize * 3, IconThumbnailModel::thumbnailSize * 2 + fontMetrics().height() * 2});
+    m_iconsView->setModel(m_filterModel);
+    connect(m_iconsView, &QListView::activated, this, &IconPickerDialog::accept);
+
+    auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    QPushButton *selectFileButton = buttonBox->addButton(tr("Select file…"), QDialogButtonBox::ActionRole);
+    connect(selectFileButton, &QPushButton::clicked, this, &IconPickerDialog::selectFile);
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &IconPickerDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &IconPickerDialog::reject);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(searchEdit);
+    layout->addWidget(m_iconsView);
+    layout->addWidget(buttonBox);
+}
+
+QString IconPickerDialog::selectedIcon() const
+{
+    if (!m_selectedFile.isEmpty())
+        return m_selectedFile;
+
+    const QModelIndex index = m_iconsView->currentIndex();
+    if (!index.isValid())
+        return m_currentIcon;
+
+    // Names are resolved by the tray using the current theme only
+    const QString theme = index.data(IconThumbnailModel::ThemeRole).toString();
+    if (theme == QIcon::themeName() || theme == QLatin1String("hicolor"))
+        return index.data(Qt::DisplayRole).toString();
+
+    return index.data(IconThumbnailModel::PathRole).toString();
+}
+
+void IconPickerDialog::selectFile()
+{
+    QFileDialog dialog(this, tr("Select icon"));
+    dialog.setNameFilter(tr("Images (*.png *.jpg *.bmp *.svg);;All files(*)"));
+    dialog.setFileMode(QFileDialog::ExistingFile);
+
+    const QFileInfo previousName = m_currentIcon;
+    dialog.setDirectory(previousName.exists() ? previousName.path() : QDir::homePath());
+
+    if (dialog.exec() == QDialog::Accepted) {
+        m_selectedFile = dialog.selectedFiles().constFirst();
+        accept();
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ICONPICKERDIALOG_H
+#define ICONPICKERDIALOG_H
+
+#include <QDialog>
+
+class QListView;
+class QSortFilterProxyModel;
+
+// Grid of icons from installed themes with search, also allows to select an image file
+class IconPickerDialog : public QDialog
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(IconPickerDialog)
+
+public:
+    explicit IconPickerDialog(const QString &currentIcon, QWidget *parent = nullptr);
+
+    // Icon name if it belongs to the current theme, otherwise file path
+    QString selectedIcon() const;
+
+private slots:
+    void selectFile();
+
+private:
+    QString m_currentIcon;
+    QString m_selectedFile;
+    QSortFilterProxyModel *m_filterModel;
+    QListView *m_iconsView;
+};
+
+#endif // ICONPICKERDIALOG_H
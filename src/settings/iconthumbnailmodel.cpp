@@ -0,0 +1,243 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "iconthumbnailmodel.h"
+
+#include "iconresolver.h"
+#include "tracescope.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QIcon>
+#include <QImageReader>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+
+#include <algorithm>
+
+namespace
+{
+constexpr quint32 s_cacheMagic = 0x4f4d5154; // "OMQT"
+constexpr quint32 s_cacheVersion = 1;
+constexpr int s_batchSize = 64;
+}
+
+class IconThumbnailModel::ThemeScan : public QRunnable
+{
+public:
+    ThemeScan(IconThumbnailModel *model, const QString &themePath)
+        : m_model(model)
+        , m_themePath(themePath)
+        , m_theme(QFileInfo(themePath).fileName())
+    {
+    }
+
+    void run() override
+    {
+        const TraceScope trace("IconThumbnailModel::ThemeScan", m_themePath);
+
+        // Resources are fast to render and have no meaningful modification time
+        const bool cacheable = !m_themePath.startsWith(':');
+        const qint64 modificationTime = themeModificationTime();
+        if (cacheable && loadCache(modificationTime))
+            return;
+
+        QHash<QString, QString> files;
+        QDirIterator it(m_themePath, {QStringLiteral("*.svg"), QStringLiteral("*.svgz"), QStringLiteral("*.png")}, QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+        while (it.hasNext()) {
+            const QString path = it.next();
+            QString &current = files[it.fileInfo().completeBaseName()];
+            if (IconResolver::isBetterIconFile(path, current))
+                current = path;
+        }
+
+        QStringList names = files.keys();
+        std::sort(names.begin(), names.end());
+
+        QVector<Entry> entries;
+        entries.reserve(names.size());
+        for (const QString &name : qAsConst(names)) {
+            if (m_model->m_cancelled)
+                return;
+
+            const QString path = files.value(name);
+            QImageReader reader(path);
+            reader.setScaledSize(reader.size().scaled(thumbnailSize, thumbnailSize, Qt::KeepAspectRatio));
+            entries.append({name, path, m_theme, reader.read()});
+            if (entries.size() % s_batchSize == 0)
+                post(entries.mid(entries.size() - s_batchSize));
+        }
+        post(entries.mid(entries.size() - entries.size() % s_batchSize));
+
+        if (cacheable)
+            saveCache(modificationTime, entries);
+    }
+
+private:
+    void post(const QVector<Entry> &entries) const
+    {
+        if (entries.isEmpty())
+            return;
+
+        IconThumbnailModel *model = m_model;
+        QMetaObject::invokeMethod(
+            model, [model, entries] { model->appendEntries(entries); }, Qt::QueuedConnection);
+    }
+
+    // Changed by package updates of the theme
+    qint64 themeModificationTime() const
+    {
+        const QDir themeDir(m_themePath);
+        return std::max(QFileInfo(m_themePath).lastModified().toMSecsSinceEpoch(), QFileInfo(themeDir.filePath(QStringLiteral("index.theme"))).lastModified().toMSecsSinceEpoch());
+    }
+
+    QString cachePath() const
+    {
+        const QByteArray hash = QCryptographicHash::hash(m_themePath.toUtf8(), QCryptographicHash::Sha1).toHex();
+        return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/icon-thumbnails/") + hash + QStringLiteral(".cache");
+    }
+
+    bool loadCache(qint64 modificationTime) const
+    {
+        QFile file(cachePath());
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_10);
+
+        quint32 magic;
+        quint32 version;
+        QString themePath;
+        qint64 cachedModificationTime;
+        qint32 cachedThumbnailSize;
+        quint32 count;
+        stream >> magic >> version >> themePath >> cachedModificationTime >> cachedThumbnailSize >> count;
+        if (stream.status() != QDataStream::Ok || magic != s_cacheMagic || version != s_cacheVersion || themePath != m_themePath
+            || cachedModificationTime != modificationTime || cachedThumbnailSize != thumbnailSize)
+            return false;
+
+        QVector<Entry> entries;
+        entries.reserve(s_batchSize);
+        for (quint32 i = 0; i < count && !m_model->m_cancelled; ++i) {
+            Entry entry;
+            entry.theme = m_theme;
+            stream >> entry.name >> entry.path >> entry.thumbnail;
+            if (stream.status() != QDataStream::Ok)
+                break;
+
+            entries.append(entry);
+            if (entries.size() == s_batchSize) {
+                post(entries);
+                entries.clear();
+            }
+        }
+        post(entries);
+        return true;
+    }
+
+    void saveCache(qint64 modificationTime, const QVector<Entry> &entries) const
+    {
+        const QString path = cachePath();
+        QDir().mkpath(QFileInfo(path).path());
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning("Unable to open icon thumbnail cache %s: %s", qPrintable(path), qPrintable(file.errorString()));
+            return;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_10);
+        stream << s_cacheMagic << s_cacheVersion << m_themePath << modificationTime << static_cast<qint32>(thumbnailSize) << static_cast<quint32>(entries.size());
+        for (const Entry &entry : entries)
+            stream << entry.name << entry.path << entry.thumbnail;
+
+        if (!file.commit())
+            qWarning("Unable to write icon thumbnail cache %s: %s", qPrintable(path), qPrintable(file.errorString()));
+    }
+
+    IconThumbnailModel *m_model;
+    const QString m_themePath;
+    const QString m_theme;
+};
+
+IconThumbnailModel::IconThumbnailModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_pool(new QThreadPool(this))
+{
+    // Each theme directory is scanned separately, big themes are rendered while small ones are already shown
+    const QStringList searchPaths = QIcon::themeSearchPaths();
+    for (const QString &searchPath : searchPaths) {
+        const QDir searchDir(searchPath);
+        const QStringList themes = searchDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString &theme : themes)
+            m_pool->start(new ThemeScan(this, searchDir.filePath(theme)));
+    }
+}
+
+IconThumbnailModel::~IconThumbnailModel()
+{
+    m_cancelled = true;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+int IconThumbnailModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_entries.size();
+}
+
+QVariant IconThumbnailModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_entries.size())
+        return {};
+
+    const Entry &entry = m_entries.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return entry.name;
+    case Qt::DecorationRole:
+        return entry.thumbnail;
+    case Qt::ToolTipRole:
+        return QStringLiteral("%1\n%2").arg(entry.theme, entry.path);
+    case PathRole:
+        return entry.path;
+    case ThemeRole:
+        return entry.theme;
+    default:
+        return {};
+    }
+}
+
+void IconThumbnailModel::appendEntries(const QVector<Entry> &entries)
+{
+    beginInsertRows({}, m_entries.size(), m_entries.size() + entries.size() - 1);
+    m_entries.append(entries);
+    endInsertRows();
+}
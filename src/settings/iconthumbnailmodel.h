@@ -0,0 +1,69 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ICONTHUMBNAILMODEL_H
+#define ICONTHUMBNAILMODEL_H
+
+#include <QAbstractListModel>
+#include <QImage>
+#include <QVector>
+
+#include <atomic>
+
+class QThreadPool;
+
+// Icons of all installed themes with thumbnails rendered on a thread pool.
+// Rows are added progressively, rendered thumbnails are cached on disk per theme directory.
+class IconThumbnailModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(IconThumbnailModel)
+
+public:
+    enum Role {
+        PathRole = Qt::UserRole,
+        ThemeRole
+    };
+
+    explicit IconThumbnailModel(QObject *parent = nullptr);
+    ~IconThumbnailModel() override;
+
+    int rowCount(const QModelIndex &parent = {}) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    static constexpr int thumbnailSize = 32;
+
+private:
+    class ThemeScan;
+
+    struct Entry {
+        QString name;
+        QString path;
+        QString theme;
+        QImage thumbnail;
+    };
+
+    void appendEntries(const QVector<Entry> &entries);
+
+    QThreadPool *m_pool;
+    QVector<Entry> m_entries;
+    std::atomic_bool m_cancelled{false};
+};
+
+#endif // ICONTHUMBNAILMODEL_H
@@ -19,6 +19,8 @@
 
 #include "optimussettings.h"
 
+#include "systempaths.h"
+
 #include <QFile>
 #include <QSettings>
 
@@ -453,12 +455,12 @@ int OptimusSettings::defaultNvidiaDynamicPowerManagementThreshold()
 
 QString OptimusSettings::permanentConfigPath()
 {
-    return QStringLiteral("/etc/optimus-manager/optimus-manager.conf");
+    return SystemPaths::permanentConfigFile();
 }
 
 QPair<QString, OptimusSettings::ConfigType> OptimusSettings::detectConfigPath()
 {
-    QFile tempPath(QStringLiteral("/var/lib/optimus-manager/temp_conf_path"));
+    QFile tempPath(SystemPaths::tempConfigPathFile());
     if (tempPath.open(QIODevice::ReadOnly))
         return {tempPath.readAll(), Temporary};
 
@@ -475,6 +477,11 @@ QString OptimusSettings::modeString(OptimusSettings::Mode gpu)
     return s_modeMap[gpu];
 }
 
+OptimusSettings::Mode OptimusSettings::modeFromString(const QString &modeString, Mode defaultMode)
+{
+    return s_modeMap.key(modeString, defaultMode);
+}
+
 QStringList OptimusSettings::nvidiaOptionsToStrings(NvidiaOptions options)
 {
     QStringList optionStrings;
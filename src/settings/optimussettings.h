@@ -198,6 +198,7 @@ public:
     static ConfigType defaultConfigType();
 
     static QString modeString(Mode gpu);
+    static Mode modeFromString(const QString &modeString, Mode defaultMode);
 
 private:
     static QStringList nvidiaOptionsToStrings(NvidiaOptions options);
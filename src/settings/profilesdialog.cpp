@@ -0,0 +1,94 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "profilesdialog.h"
+
+#include <QDialogButtonBox>
+#include <QHBoxLayout>
+#include <QListWidget>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSet>
+#include <QVBoxLayout>
+
+ProfilesDialog::ProfilesDialog(QWidget *parent)
+    : QDialog(parent)
+    , m_profiles(AppSettings().configProfiles())
+    , m_profilesWidget(new QListWidget(this))
+{
+    setWindowTitle(tr("Profiles"));
+
+    // Items keep index of their profile, so commands survive renaming and removal
+    for (int i = 0; i < m_profiles.size(); ++i) {
+        auto *item = new QListWidgetItem(m_profiles.at(i).name, m_profilesWidget);
+        item->setFlags(item->flags() | Qt::ItemIsEditable);
+        item->setData(Qt::UserRole, i);
+    }
+
+    auto *renameButton = new QPushButton(QIcon::fromTheme(QStringLiteral("edit-rename")), tr("Rename"), this);
+    auto *removeButton = new QPushButton(QIcon::fromTheme(QStringLiteral("list-remove")), tr("Remove"), this);
+    renameButton->setEnabled(false);
+    removeButton->setEnabled(false);
+    connect(m_profilesWidget, &QListWidget::currentItemChanged, [renameButton, removeButton](QListWidgetItem *current) {
+        renameButton->setEnabled(current != nullptr);
+        removeButton->setEnabled(current != nullptr);
+    });
+    connect(renameButton, &QPushButton::clicked, [this] { m_profilesWidget->editItem(m_profilesWidget->currentItem()); });
+    connect(removeButton, &QPushButton::clicked, [this] { delete m_profilesWidget->currentItem(); });
+
+    auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &ProfilesDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &ProfilesDialog::reject);
+
+    auto *profileButtonsLayout = new QVBoxLayout;
+    profileButtonsLayout->addWidget(renameButton);
+    profileButtonsLayout->addWidget(removeButton);
+    profileButtonsLayout->addStretch();
+
+    auto *profilesLayout = new QHBoxLayout;
+    profilesLayout->addWidget(m_profilesWidget);
+    profilesLayout->addLayout(profileButtonsLayout);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addLayout(profilesLayout);
+    layout->addWidget(buttonBox);
+}
+
+void ProfilesDialog::accept()
+{
+    QVector<AppSettings::ConfigProfile> profiles;
+    QSet<QString> names;
+    for (int i = 0; i < m_profilesWidget->count(); ++i) {
+        const QListWidgetItem *item = m_profilesWidget->item(i);
+        const QString name = item->text().trimmed();
+        if (name.isEmpty() || names.contains(name)) {
+            QMessageBox message(this);
+            message.setIcon(QMessageBox::Warning);
+            message.setText(tr("Profile names must not be empty or repeated"));
+            message.exec();
+            return;
+        }
+
+        names.insert(name);
+        profiles.append({name, m_profiles.at(item->data(Qt::UserRole).toInt()).command});
+    }
+
+    AppSettings().setConfigProfiles(profiles);
+    QDialog::accept();
+}
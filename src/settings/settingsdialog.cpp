@@ -20,19 +20,34 @@
 #include "settingsdialog.h"
 #include "ui_settingsdialog.h"
 
+#include "applicationpickerdialog.h"
 #include "appsettings.h"
 #include "daemonclient.h"
+#include "gputopology.h"
+#ifndef WITH_PLASMA
+#include "iconpickerdialog.h"
+#endif
+#include "iconresolver.h"
 #include "optimussettings.h"
+#include "profilesdialog.h"
+#include "switchjournal.h"
+#include "switchjournaldialog.h"
+#include "systempaths.h"
+#include "tracescope.h"
 #include "autostartmanager/abstractautostartmanager.h"
 
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
 #include <QMetaEnum>
+#include <QTemporaryFile>
 #include <QTextStream>
 #ifdef WITH_PLASMA
 #include <KIconDialog>
 #endif
 
+#include <algorithm>
+
 SettingsDialog::SettingsDialog(QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::SettingsDialog)
@@ -43,6 +58,7 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     ui->logoLabel->setPixmap(QIcon::fromTheme(QStringLiteral("optimus-manager")).pixmap(512, 512));
     ui->versionGuiLabel->setText(QCoreApplication::applicationVersion());
     ui->versionLabel->setText(optimusManagerVersion());
+    connect(IconResolver::instance(), &IconResolver::resolved, this, &SettingsDialog::showIconPreview);
 
     // Set languages data
     ui->localeComboBox->addItem(tr("<System language>"), AppSettings::defaultLocale());
@@ -65,6 +81,16 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     auto [path, type] = OptimusSettings::detectConfigPath();
     ui->optimusConfigTypeComboBox->setCurrentIndex(type);
     ui->optimusConfigPathEdit->setText(path);
+
+    // Hide settings for GPUs that cannot be present.
+    // Integrated GPUs stay on the bus, Nvidia GPU is removed in Integrated mode unless nothing powers it off.
+    if (const GpuTopology *topology = GpuTopology::instance(); topology != nullptr) {
+        const OptimusSettings optimusSettings(path);
+        const bool nvidiaRemovable = optimusSettings.switchingMethod() != OptimusSettings::NoneMethod || optimusSettings.isPciRemoveEnabled();
+        ui->pagesListWidget->item(ui->pagesStackedWidget->indexOf(ui->intelPage))->setHidden(!topology->mayHaveVendor(GpuDevice::Intel));
+        ui->pagesListWidget->item(ui->pagesStackedWidget->indexOf(ui->amdPage))->setHidden(!topology->mayHaveVendor(GpuDevice::Amd));
+        ui->pagesListWidget->item(ui->pagesStackedWidget->indexOf(ui->nvidiaPage))->setHidden(!nvidiaRemovable && !topology->wasVendorSeen(GpuDevice::Nvidia));
+    }
 }
 
 SettingsDialog::~SettingsDialog()
@@ -79,13 +105,19 @@ bool SettingsDialog::isLanguageChanged() const
 
 void SettingsDialog::accept()
 {
+    const TraceScope trace("SettingsDialog::accept");
+    const bool permanentConfig = ui->optimusConfigTypeComboBox->currentIndex() == OptimusSettings::Permanent;
+    SwitchJournal::Recorder journal(SwitchJournal::ConfigApply, permanentConfig ? QStringLiteral("permanent") : QStringLiteral("temporary"));
+
     // Check Optimus Manager config path
+    journal.beginPhase(QStringLiteral("configPath"));
     const QString configPath = configurationPath();
     if (configPath.isEmpty()) {
         QMessageBox message;
         message.setIcon(QMessageBox::Critical);
         message.setText(tr("Optimus Manager temporary configuration file path cannot be empty"));
         message.exec();
+        journal.setResult(SwitchJournal::Failed);
         return;
     }
     if (configPath == OptimusSettings::permanentConfigPath()) {
@@ -93,14 +125,22 @@ void SettingsDialog::accept()
         message.setIcon(QMessageBox::Critical);
         message.setText(tr("Optimus Manager temporary configuration file path cannot be a permanent configuration file path"));
         message.exec();
+        journal.setResult(SwitchJournal::Failed);
         return;
     }
 
-    saveOptimusSettings(configPath);
+    journal.beginPhase(QStringLiteral("saveConfig"));
+    {
+        const TraceScope saveTrace("saveOptimusSettings", configPath);
+        saveOptimusSettings(configPath);
+    }
 
+    journal.beginPhase(QStringLiteral("daemonConnect"));
     DaemonClient client;
     client.connect();
     if (client.error()) {
+        journal.setResult(SwitchJournal::Failed);
+        journal.setSendError(client.errorString());
         QMessageBox message;
         message.setIcon(QMessageBox::Critical);
         message.setText(DaemonClient::tr("Unable to connect to Optimus Manager daemon: %1").arg(client.errorString()));
@@ -108,20 +148,26 @@ void SettingsDialog::accept()
         return;
     }
 
-    if (ui->optimusConfigTypeComboBox->currentIndex() == OptimusSettings::Permanent) {
-        QFile configFile(configPath);
-        if (!configFile.open(QIODevice::ReadOnly)) {
-            QMessageBox message;
-            message.setIcon(QMessageBox::Critical);
-            message.setText(tr("Unable to read data from generated configuration"));
-            message.exec();
-            return;
+    journal.beginPhase(QStringLiteral("daemonSend"));
+    if (permanentConfig) {
+        QString configData;
+        {
+            const TraceScope readTrace("readGeneratedConfig", configPath);
+            QFile configFile(configPath);
+            if (!configFile.open(QIODevice::ReadOnly)) {
+                QMessageBox message;
+                message.setIcon(QMessageBox::Critical);
+                message.setText(tr("Unable to read data from generated configuration"));
+                message.exec();
+                journal.setResult(SwitchJournal::Failed);
+                return;
+            }
+
+            QTextStream configStream(&configFile);
+            configData = configStream.readAll();
+            configFile.remove();
         }
 
-        QTextStream configStream(&configFile);
-        const QString configData = configStream.readAll();
-        configFile.remove();
-
         client.setConfig(configData);
         client.setTempConfig({});
     } else {
@@ -129,6 +175,8 @@ void SettingsDialog::accept()
     }
 
     if (client.error()) {
+        journal.setResult(SwitchJournal::Failed);
+        journal.setSendError(client.errorString());
         QMessageBox message;
         message.setIcon(QMessageBox::Critical);
         message.setText(DaemonClient::tr("Unable to send configuration file to Optimus Manager daemon: %1").arg(client.errorString()));
@@ -158,17 +206,32 @@ void SettingsDialog::browseHybridIcon()
 
 void SettingsDialog::previewIntegratedIcon(const QString &fileName)
 {
-    ui->integratedIconButton->setIcon(QIcon::fromTheme(fileName));
+    IconResolver::instance()->request(OptimusSettings::Integrated, fileName, ui->integratedIconButton->iconSize().width());
 }
 
 void SettingsDialog::previewNvidiaIcon(const QString &fileName)
 {
-    ui->nvidiaIconButton->setIcon(QIcon::fromTheme(fileName));
+    IconResolver::instance()->request(OptimusSettings::Nvidia, fileName, ui->nvidiaIconButton->iconSize().width());
 }
 
 void SettingsDialog::previewHybridIcon(const QString &fileName)
 {
-    ui->hybridIconButton->setIcon(QIcon::fromTheme(fileName));
+    IconResolver::instance()->request(OptimusSettings::Hybrid, fileName, ui->hybridIconButton->iconSize().width());
+}
+
+void SettingsDialog::showIconPreview(int mode, const QIcon &icon)
+{
+    switch (mode) {
+    case OptimusSettings::Integrated:
+        ui->integratedIconButton->setIcon(icon);
+        break;
+    case OptimusSettings::Nvidia:
+        ui->nvidiaIconButton->setIcon(icon);
+        break;
+    case OptimusSettings::Hybrid:
+        ui->hybridIconButton->setIcon(icon);
+        break;
+    }
 }
 
 void SettingsDialog::onOptimusConfigTypeChanged(int configType)
@@ -293,10 +356,87 @@ void SettingsDialog::importOptimusConfig()
         loadOptimusSettings(dialog.selectedFiles().constFirst());
 }
 
+// Stores the generated configuration already serialized as a daemon command
+void SettingsDialog::saveOptimusProfile()
+{
+    bool ok;
+    const QString name = QInputDialog::getText(this, tr("Save as profile"), tr("Profile name:"), QLineEdit::Normal, {}, &ok).trimmed();
+    if (!ok || name.isEmpty())
+        return;
+
+    AppSettings appSettings;
+    QVector<AppSettings::ConfigProfile> profiles = appSettings.configProfiles();
+    auto profile = std::find_if(profiles.begin(), profiles.end(), [&name](const AppSettings::ConfigProfile &existingProfile) {
+        return existingProfile.name == name;
+    });
+    if (profile != profiles.end()) {
+        QMessageBox message(this);
+        message.setIcon(QMessageBox::Question);
+        message.setText(tr("Profile '%1' already exists. Replace it?").arg(name));
+        message.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+        if (message.exec() != QMessageBox::Yes)
+            return;
+    } else {
+        profile = profiles.insert(profiles.end(), {name, {}});
+    }
+
+    QTemporaryFile configFile;
+    if (!configFile.open()) {
+        QMessageBox message(this);
+        message.setIcon(QMessageBox::Critical);
+        message.setText(tr("Unable to create temporary file for profile: %1").arg(configFile.errorString()));
+        message.exec();
+        return;
+    }
+    saveOptimusSettings(configFile.fileName());
+
+    // QSettings replaces the file, so it needs to be opened again
+    QFile generatedFile(configFile.fileName());
+    if (!generatedFile.open(QIODevice::ReadOnly)) {
+        QMessageBox message(this);
+        message.setIcon(QMessageBox::Critical);
+        message.setText(tr("Unable to read data from generated configuration"));
+        message.exec();
+        return;
+    }
+
+    profile->command = DaemonClient::configCommand(QTextStream(&generatedFile).readAll());
+    appSettings.setConfigProfiles(profiles);
+}
+
+void SettingsDialog::manageOptimusProfiles()
+{
+    ProfilesDialog dialog(this);
+    dialog.exec();
+}
+
+void SettingsDialog::showSwitchJournal()
+{
+    SwitchJournalDialog dialog(this);
+    dialog.exec();
+}
+
+void SettingsDialog::addOffloadRule()
+{
+    ApplicationPickerDialog dialog(this);
+    if (dialog.exec() != QDialog::Accepted || dialog.selectedCommand().isEmpty())
+        return;
+
+    auto *item = new QListWidgetItem(dialog.selectedName(), ui->offloadRulesListWidget);
+    item->setData(Qt::UserRole, dialog.selectedCommand());
+    item->setToolTip(dialog.selectedCommand());
+}
+
+void SettingsDialog::removeOffloadRule()
+{
+    delete ui->offloadRulesListWidget->currentItem();
+}
+
 void SettingsDialog::loadOptimusSettingsPath(const QString &path)
 {
     ui->exportOptimusConfigButton->setEnabled(!path.isEmpty());
     ui->importOptimusConfigButton->setEnabled(!path.isEmpty());
+    ui->saveOptimusProfileButton->setEnabled(!path.isEmpty());
 
     loadOptimusSettings(path);
 }
@@ -307,9 +447,12 @@ void SettingsDialog::restoreDefaults()
     ui->localeComboBox->setCurrentIndex(ui->localeComboBox->findData(AppSettings::defaultLocale()));
     ui->autostartCheckBox->setChecked(AppSettings::defaultAutostartEnabled());
     ui->confirmSwitchingCheckBox->setChecked(AppSettings::defaultConfirmSwitching());
+    ui->powerPolicyCheckBox->setChecked(AppSettings::defaultPowerPolicyEnabled());
+    ui->metricsFileEdit->clear();
     ui->integratedIconEdit->setText(AppSettings::defaultModeIconName(OptimusSettings::Integrated));
     ui->nvidiaIconEdit->setText(AppSettings::defaultModeIconName(OptimusSettings::Nvidia));
     ui->hybridIconEdit->setText(AppSettings::defaultModeIconName(OptimusSettings::Hybrid));
+    ui->offloadRulesListWidget->clear();
 
     // Configuration files settings
     ui->optimusConfigTypeComboBox->setCurrentIndex(OptimusSettings::defaultConfigType());
@@ -362,9 +505,17 @@ void SettingsDialog::loadAppSettings()
     ui->localeComboBox->setCurrentIndex(ui->localeComboBox->findData(settings.locale()));
     ui->autostartCheckBox->setChecked(m_autostartManager->isAutostartEnabled());
     ui->confirmSwitchingCheckBox->setChecked(settings.isConfirmSwitching());
+    ui->powerPolicyCheckBox->setChecked(settings.isPowerPolicyEnabled());
+    ui->metricsFileEdit->setText(settings.metricsFilePath());
     ui->integratedIconEdit->setText(settings.modeIconName(OptimusSettings::Integrated));
     ui->nvidiaIconEdit->setText(settings.modeIconName(OptimusSettings::Nvidia));
     ui->hybridIconEdit->setText(settings.modeIconName(OptimusSettings::Hybrid));
+
+    for (const AppSettings::OffloadRule &rule : settings.offloadRules()) {
+        auto *item = new QListWidgetItem(rule.name, ui->offloadRulesListWidget);
+        item->setData(Qt::UserRole, rule.command);
+        item->setToolTip(rule.command);
+    }
 }
 
 void SettingsDialog::saveAppSettings()
@@ -377,11 +528,24 @@ void SettingsDialog::saveAppSettings()
     }
 
     // General settings
-    m_autostartManager->setAutostartEnabled(ui->autostartCheckBox->isChecked());
+    {
+        const TraceScope trace("setAutostartEnabled");
+        m_autostartManager->setAutostartEnabled(ui->autostartCheckBox->isChecked());
+    }
     appSettings.setConfirmSwitching(ui->confirmSwitchingCheckBox->isChecked());
+    appSettings.setPowerPolicyEnabled(ui->powerPolicyCheckBox->isChecked());
+    appSettings.setMetricsFilePath(ui->metricsFileEdit->text());
     appSettings.setModeIconName(OptimusSettings::Integrated, ui->integratedIconEdit->text());
     appSettings.setModeIconName(OptimusSettings::Nvidia, ui->nvidiaIconEdit->text());
     appSettings.setModeIconName(OptimusSettings::Hybrid, ui->hybridIconEdit->text());
+
+    QVector<AppSettings::OffloadRule> offloadRules;
+    offloadRules.reserve(ui->offloadRulesListWidget->count());
+    for (int i = 0; i < ui->offloadRulesListWidget->count(); ++i) {
+        const QListWidgetItem *item = ui->offloadRulesListWidget->item(i);
+        offloadRules.append({item->text(), item->data(Qt::UserRole).toString()});
+    }
+    appSettings.setOffloadRules(offloadRules);
 }
 
 void SettingsDialog::loadOptimusSettings(const QString &path)
@@ -473,15 +637,9 @@ void SettingsDialog::browseIcon(QLineEdit *iconNameEdit)
     if (!iconName.isEmpty())
         iconNameEdit->setText(iconName);
 #else
-    QFileDialog dialog(this, tr("Select icon"));
-    dialog.setNameFilter(tr("Images (*.png *.jpg *.bmp);;All files(*)"));
-    dialog.setFileMode(QFileDialog::ExistingFile);
-
-    const QFileInfo previousName = iconNameEdit->text();
-    dialog.setDirectory(previousName.exists() ? previousName.path() : QDir::homePath());
-
+    IconPickerDialog dialog(iconNameEdit->text(), this);
     if (dialog.exec() == QDialog::Accepted)
-        iconNameEdit->setText(dialog.selectedFiles().constFirst());
+        iconNameEdit->setText(dialog.selectedIcon());
 #endif
 }
 
@@ -501,7 +659,7 @@ QString SettingsDialog::configurationPath() const
 QString SettingsDialog::optimusManagerVersion()
 {
     // Parse Optimus Manager version
-    QFile optimusManagerBin(QStringLiteral("/usr/bin/optimus-manager"));
+    QFile optimusManagerBin(SystemPaths::optimusManagerExecutable());
     if (!optimusManagerBin.open(QIODevice::ReadOnly)) {
         QMessageBox message;
         message.setIcon(QMessageBox::Critical);
@@ -20,8 +20,11 @@
 #ifndef SETTINGSDIALOG_H
 #define SETTINGSDIALOG_H
 
+#include "externalresource.h"
+
 #include <QDialog>
 
+class QIcon;
 class QLineEdit;
 class AbstractAutostartManager;
 
@@ -51,6 +54,7 @@ private slots:
     void previewIntegratedIcon(const QString &fileName);
     void previewNvidiaIcon(const QString &fileName);
     void previewHybridIcon(const QString &fileName);
+    void showIconPreview(int mode, const QIcon &icon);
 
     void onOptimusConfigTypeChanged(int configType);
     void onStartupModeChanged(int startupMode);
@@ -62,6 +66,11 @@ private slots:
     void browseTempConfigPath();
     void exportOptimusConfig();
     void importOptimusConfig();
+    void saveOptimusProfile();
+    void manageOptimusProfiles();
+    void showSwitchJournal();
+    void addOffloadRule();
+    void removeOffloadRule();
 
     void loadOptimusSettingsPath(const QString &path);
 
@@ -80,6 +89,10 @@ private:
 
     static QString optimusManagerVersion();
 
+    // Must be registered before UI setup
+    ExternalResource m_flagsResource{QStringLiteral("flags.rcc")};
+    ExternalResource m_iconThemeResource{QStringLiteral("icon-theme.rcc"), ExternalResource::IconTheme};
+
     Ui::SettingsDialog *ui;
 
     // Manage platform-dependant autostart
@@ -0,0 +1,83 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "switchjournaldialog.h"
+
+#include "switchjournal.h"
+
+#include <QDateTime>
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+SwitchJournalDialog::SwitchJournalDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(tr("Switch journal"));
+    resize(800, 500);
+
+    auto *entriesWidget = new QTreeWidget(this);
+    entriesWidget->setHeaderLabels({tr("Time"), tr("Operation"), tr("Mode"), tr("Result"), tr("Duration"), tr("Decision wait"), tr("Details")});
+    entriesWidget->setRootIsDecorated(true);
+
+    const QVector<SwitchJournal::Entry> entries = SwitchJournal::entries();
+    for (auto entry = entries.crbegin(); entry != entries.crend(); ++entry) {
+        qint64 duration = 0;
+        qint64 decisionWait = 0;
+        for (const SwitchJournal::Phase &phase : entry->phases) {
+            duration += phase.duration;
+            decisionWait += phase.decisionWait;
+        }
+
+        QString details = entry->sendError;
+        if (!entry->logoutMethod.isEmpty())
+            details = tr("Logout: %1").arg(entry->logoutMethod);
+
+        auto *entryItem = new QTreeWidgetItem(entriesWidget, {QDateTime::fromMSecsSinceEpoch(entry->timestamp).toString(Qt::ISODate),
+                                                               SwitchJournal::operationString(entry->operation),
+                                                               entry->mode,
+                                                               SwitchJournal::resultString(entry->outcome),
+                                                               durationString(duration),
+                                                               durationString(decisionWait),
+                                                               details});
+
+        for (const SwitchJournal::Phase &phase : entry->phases) {
+            new QTreeWidgetItem(entryItem, {QString(),
+                                            phase.name,
+                                            QString(),
+                                            SwitchJournal::resultString(phase.result),
+                                            durationString(phase.duration),
+                                            durationString(phase.decisionWait)});
+        }
+    }
+    entriesWidget->header()->resizeSections(QHeaderView::ResizeToContents);
+
+    auto *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &SwitchJournalDialog::reject);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addWidget(entriesWidget);
+    layout->addWidget(buttonBox);
+}
+
+QString SwitchJournalDialog::durationString(qint64 duration)
+{
+    return tr("%1 ms").arg(static_cast<double>(duration) / 1000, 0, 'f', 1);
+}
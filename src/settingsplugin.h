@@ -0,0 +1,37 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SETTINGSPLUGIN_H
+#define SETTINGSPLUGIN_H
+
+#include <QtPlugin>
+
+// Interface of the settings UI module, which is loaded only while settings are open
+class SettingsPlugin
+{
+public:
+    virtual ~SettingsPlugin() = default;
+
+    // Shows modal settings dialog, returns true if settings were applied
+    virtual bool execSettingsDialog(bool &languageChanged) = 0;
+};
+
+Q_DECLARE_INTERFACE(SettingsPlugin, "io.optimus_manager.OptimusManagerQt.SettingsPlugin/1.0")
+
+#endif // SETTINGSPLUGIN_H
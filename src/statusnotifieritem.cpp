@@ -0,0 +1,338 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "statusnotifieritem.h"
+
+#include "dbusmenuexporter.h"
+
+#include <QCoreApplication>
+#include <QCursor>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusServiceWatcher>
+#include <QFileInfo>
+#include <QIcon>
+#include <QImage>
+#include <QMenu>
+#include <QSystemTrayIcon>
+#include <QtEndian>
+
+namespace
+{
+const QString s_watcherService = QStringLiteral("org.kde.StatusNotifierWatcher");
+const QString s_itemPath = QStringLiteral("/StatusNotifierItem");
+const QString s_menuPath = QStringLiteral("/MenuBar");
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusImage &image)
+{
+    argument.beginStructure();
+    argument << image.width << image.height << image.data;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusImage &image)
+{
+    argument.beginStructure();
+    argument >> image.width >> image.height >> image.data;
+    argument.endStructure();
+    return argument;
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusToolTip &toolTip)
+{
+    argument.beginStructure();
+    argument << toolTip.iconName << toolTip.iconPixmap << toolTip.title << toolTip.description;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusToolTip &toolTip)
+{
+    argument.beginStructure();
+    argument >> toolTip.iconName >> toolTip.iconPixmap >> toolTip.title >> toolTip.description;
+    argument.endStructure();
+    return argument;
+}
+
+StatusNotifierItem::StatusNotifierItem(QObject *parent)
+    : QObject(parent)
+    , m_serviceName(QStringLiteral("org.kde.StatusNotifierItem-%1-1").arg(QCoreApplication::applicationPid()))
+{
+    qDBusRegisterMetaType<DBusImage>();
+    qDBusRegisterMetaType<DBusImageList>();
+    qDBusRegisterMetaType<DBusToolTip>();
+
+    new StatusNotifierItemAdaptor(this);
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.registerObject(s_itemPath, this, QDBusConnection::ExportAdaptors))
+        qWarning("Unable to register D-Bus object %s", qPrintable(s_itemPath));
+    if (!bus.registerService(m_serviceName))
+        qWarning("Unable to register D-Bus service %s", qPrintable(m_serviceName));
+
+    // Register again when the tray host is restarted
+    auto *watcher = new QDBusServiceWatcher(s_watcherService, bus, QDBusServiceWatcher::WatchForRegistration | QDBusServiceWatcher::WatchForUnregistration, this);
+    connect(watcher, &QDBusServiceWatcher::serviceRegistered, this, &StatusNotifierItem::registerItem);
+    connect(watcher, &QDBusServiceWatcher::serviceUnregistered, this, &StatusNotifierItem::enableFallback);
+    connect(this, &StatusNotifierItem::iconChanged, this, &StatusNotifierItem::updateFallback);
+    connect(this, &StatusNotifierItem::toolTipChanged, this, &StatusNotifierItem::updateFallback);
+    if (bus.interface()->isServiceRegistered(s_watcherService))
+        registerItem();
+    else
+        enableFallback();
+}
+
+StatusNotifierItem::~StatusNotifierItem()
+{
+    delete m_menu;
+    QDBusConnection::sessionBus().unregisterService(m_serviceName);
+}
+
+QString StatusNotifierItem::iconName() const
+{
+    return m_iconName;
+}
+
+void StatusNotifierItem::setIconByName(const QString &name)
+{
+    m_iconName = name;
+    emit iconChanged();
+}
+
+QString StatusNotifierItem::toolTipIconName() const
+{
+    return m_toolTipIconName;
+}
+
+void StatusNotifierItem::setToolTipIconByName(const QString &name)
+{
+    m_toolTipIconName = name;
+    emit toolTipChanged();
+}
+
+QString StatusNotifierItem::toolTipTitle() const
+{
+    return m_toolTipTitle;
+}
+
+void StatusNotifierItem::setToolTipTitle(const QString &title)
+{
+    m_toolTipTitle = title;
+    emit toolTipChanged();
+}
+
+QString StatusNotifierItem::toolTipSubTitle() const
+{
+    return m_toolTipSubTitle;
+}
+
+void StatusNotifierItem::setToolTipSubTitle(const QString &subTitle)
+{
+    m_toolTipSubTitle = subTitle;
+    emit toolTipChanged();
+}
+
+QMenu *StatusNotifierItem::contextMenu() const
+{
+    return m_menu;
+}
+
+void StatusNotifierItem::setContextMenu(QMenu *menu)
+{
+    if (m_menu == menu)
+        return;
+
+    if (m_menuExporter != nullptr) {
+        QDBusConnection::sessionBus().unregisterObject(s_menuPath);
+        delete m_menuExporter;
+        delete m_menu;
+    }
+
+    m_menu = menu;
+    m_menuExporter = new DBusMenuExporter(s_menuPath, m_menu, this);
+    if (m_fallbackIcon != nullptr)
+        m_fallbackIcon->setContextMenu(m_menu);
+}
+
+void StatusNotifierItem::showMessage(const QString &title, const QString &message, const QString &iconName)
+{
+    QDBusMessage notification = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.Notifications"), QStringLiteral("/org/freedesktop/Notifications"),
+                                                               QStringLiteral("org.freedesktop.Notifications"), QStringLiteral("Notify"));
+    notification << QCoreApplication::applicationName() << 0U << iconName << title << message << QStringList() << QVariantMap() << -1;
+    QDBusConnection::sessionBus().call(notification, QDBus::NoBlock);
+}
+
+// Hosts without access to the icon theme or file use pixmaps
+DBusImageList StatusNotifierItem::iconPixmap(const QString &iconName)
+{
+    const QIcon icon = QFileInfo::exists(iconName) ? QIcon(iconName) : QIcon::fromTheme(iconName);
+
+    DBusImageList images;
+    for (int size : {16, 22, 32, 48}) {
+        const QImage image = icon.pixmap(size).toImage().convertToFormat(QImage::Format_ARGB32);
+        if (image.isNull())
+            continue;
+
+        DBusImage dbusImage;
+        dbusImage.width = image.width();
+        dbusImage.height = image.height();
+        dbusImage.data = QByteArray(reinterpret_cast<const char *>(image.constBits()), static_cast<int>(image.sizeInBytes()));
+
+        auto *pixels = reinterpret_cast<quint32 *>(dbusImage.data.data());
+        for (int i = 0; i < dbusImage.data.size() / 4; ++i)
+            pixels[i] = qToBigEndian(pixels[i]);
+
+        images.append(dbusImage);
+    }
+
+    return images;
+}
+
+void StatusNotifierItem::registerItem()
+{
+    QDBusMessage registration = QDBusMessage::createMethodCall(s_watcherService, QStringLiteral("/StatusNotifierWatcher"), s_watcherService,
+                                                               QStringLiteral("RegisterStatusNotifierItem"));
+    registration << m_serviceName;
+    QDBusConnection::sessionBus().call(registration, QDBus::NoBlock);
+
+    delete m_fallbackIcon;
+    m_fallbackIcon = nullptr;
+}
+
+void StatusNotifierItem::enableFallback()
+{
+    if (m_fallbackIcon != nullptr)
+        return;
+
+    if (!QSystemTrayIcon::isSystemTrayAvailable())
+        qWarning("StatusNotifierWatcher is not running and no system tray is available, the tray icon will not be shown");
+    else
+        qWarning("StatusNotifierWatcher is not running, using QSystemTrayIcon until it is started");
+
+    m_fallbackIcon = new QSystemTrayIcon(this);
+    m_fallbackIcon->setContextMenu(m_menu);
+    connect(m_fallbackIcon, &QSystemTrayIcon::activated, this, [this](QSystemTrayIcon::ActivationReason reason) {
+        if (reason == QSystemTrayIcon::Trigger && m_menu != nullptr)
+            m_menu->popup(QCursor::pos());
+    });
+    updateFallback();
+    m_fallbackIcon->show();
+}
+
+void StatusNotifierItem::updateFallback()
+{
+    if (m_fallbackIcon == nullptr)
+        return;
+
+    m_fallbackIcon->setIcon(QFileInfo::exists(m_iconName) ? QIcon(m_iconName) : QIcon::fromTheme(m_iconName));
+    QString toolTip = m_toolTipTitle;
+    if (!m_toolTipSubTitle.isEmpty())
+        toolTip += '\n' + QString(m_toolTipSubTitle).replace(QLatin1String("<br>"), QLatin1String("\n"));
+    m_fallbackIcon->setToolTip(toolTip);
+}
+
+StatusNotifierItemAdaptor::StatusNotifierItemAdaptor(StatusNotifierItem *item)
+    : QDBusAbstractAdaptor(item)
+    , m_item(item)
+{
+    connect(m_item, &StatusNotifierItem::iconChanged, this, &StatusNotifierItemAdaptor::NewIcon);
+    connect(m_item, &StatusNotifierItem::toolTipChanged, this, &StatusNotifierItemAdaptor::NewToolTip);
+}
+
+QString StatusNotifierItemAdaptor::category() const
+{
+    return QStringLiteral("SystemServices");
+}
+
+QString StatusNotifierItemAdaptor::id() const
+{
+    return QCoreApplication::applicationName();
+}
+
+QString StatusNotifierItemAdaptor::title() const
+{
+    return QCoreApplication::applicationName();
+}
+
+QString StatusNotifierItemAdaptor::status() const
+{
+    return QStringLiteral("Active");
+}
+
+int StatusNotifierItemAdaptor::windowId() const
+{
+    return 0;
+}
+
+// Not all hosts accept paths as icon names, so custom icon files are sent only as pixmaps
+QString StatusNotifierItemAdaptor::iconName() const
+{
+    return QFileInfo::exists(m_item->iconName()) ? QString() : m_item->iconName();
+}
+
+DBusImageList StatusNotifierItemAdaptor::iconPixmap() const
+{
+    return StatusNotifierItem::iconPixmap(m_item->iconName());
+}
+
+DBusToolTip StatusNotifierItemAdaptor::toolTip() const
+{
+    DBusToolTip toolTip;
+    toolTip.iconName = m_item->toolTipIconName();
+    toolTip.title = m_item->toolTipTitle();
+    toolTip.description = m_item->toolTipSubTitle();
+    return toolTip;
+}
+
+// Menu is shown by the host with dbusmenu
+bool StatusNotifierItemAdaptor::itemIsMenu() const
+{
+    return true;
+}
+
+QDBusObjectPath StatusNotifierItemAdaptor::menu() const
+{
+    return QDBusObjectPath(s_menuPath);
+}
+
+void StatusNotifierItemAdaptor::ContextMenu(int x, int y)
+{
+    if (QMenu *contextMenu = m_item->contextMenu(); contextMenu != nullptr)
+        contextMenu->popup(QPoint(x, y));
+}
+
+void StatusNotifierItemAdaptor::Activate(int x, int y)
+{
+    ContextMenu(x, y);
+}
+
+void StatusNotifierItemAdaptor::SecondaryActivate(int x, int y)
+{
+    Q_UNUSED(x)
+    Q_UNUSED(y)
+}
+
+void StatusNotifierItemAdaptor::Scroll(int delta, const QString &orientation)
+{
+    Q_UNUSED(delta)
+    Q_UNUSED(orientation)
+}
@@ -0,0 +1,151 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATUSNOTIFIERITEM_H
+#define STATUSNOTIFIERITEM_H
+
+#include <QDBusAbstractAdaptor>
+#include <QDBusArgument>
+#include <QDBusObjectPath>
+
+class DBusMenuExporter;
+class QMenu;
+class QSystemTrayIcon;
+
+// Structures of org.kde.StatusNotifierItem protocol
+struct DBusImage {
+    int width = 0;
+    int height = 0;
+    QByteArray data; // ARGB32 in network byte order
+};
+using DBusImageList = QList<DBusImage>;
+
+struct DBusToolTip {
+    QString iconName;
+    DBusImageList iconPixmap;
+    QString title;
+    QString description;
+};
+
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusImage &image);
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusImage &image);
+QDBusArgument &operator<<(QDBusArgument &argument, const DBusToolTip &toolTip);
+const QDBusArgument &operator>>(const QDBusArgument &argument, DBusToolTip &toolTip);
+
+Q_DECLARE_METATYPE(DBusImage)
+Q_DECLARE_METATYPE(DBusImageList)
+Q_DECLARE_METATYPE(DBusToolTip)
+
+// Tray icon implemented directly on top of QtDBus with a subset of KStatusNotifierItem API.
+// Menu is exported with com.canonical.dbusmenu and notifications are sent with org.freedesktop.Notifications.
+// Like KStatusNotifierItem, falls back to QSystemTrayIcon while no StatusNotifierWatcher is running.
+class StatusNotifierItem : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(StatusNotifierItem)
+
+public:
+    explicit StatusNotifierItem(QObject *parent = nullptr);
+    ~StatusNotifierItem() override;
+
+    QString iconName() const;
+    void setIconByName(const QString &name);
+
+    QString toolTipIconName() const;
+    void setToolTipIconByName(const QString &name);
+    QString toolTipTitle() const;
+    void setToolTipTitle(const QString &title);
+    QString toolTipSubTitle() const;
+    void setToolTipSubTitle(const QString &subTitle);
+
+    // Takes ownership of the menu like KStatusNotifierItem
+    QMenu *contextMenu() const;
+    void setContextMenu(QMenu *menu);
+
+    void showMessage(const QString &title, const QString &message, const QString &iconName);
+
+    static DBusImageList iconPixmap(const QString &iconName);
+
+signals:
+    void iconChanged();
+    void toolTipChanged();
+
+private slots:
+    void registerItem();
+    void enableFallback();
+    void updateFallback();
+
+private:
+    QString m_serviceName;
+    QString m_iconName;
+    QString m_toolTipIconName;
+    QString m_toolTipTitle;
+    QString m_toolTipSubTitle;
+    QMenu *m_menu = nullptr;
+    DBusMenuExporter *m_menuExporter = nullptr;
+    QSystemTrayIcon *m_fallbackIcon = nullptr;
+};
+
+class StatusNotifierItemAdaptor : public QDBusAbstractAdaptor
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.StatusNotifierItem")
+    Q_PROPERTY(QString Category READ category)
+    Q_PROPERTY(QString Id READ id)
+    Q_PROPERTY(QString Title READ title)
+    Q_PROPERTY(QString Status READ status)
+    Q_PROPERTY(int WindowId READ windowId)
+    Q_PROPERTY(QString IconName READ iconName)
+    Q_PROPERTY(DBusImageList IconPixmap READ iconPixmap)
+    Q_PROPERTY(DBusToolTip ToolTip READ toolTip)
+    Q_PROPERTY(bool ItemIsMenu READ itemIsMenu)
+    Q_PROPERTY(QDBusObjectPath Menu READ menu)
+    Q_DISABLE_COPY(StatusNotifierItemAdaptor)
+
+public:
+    explicit StatusNotifierItemAdaptor(StatusNotifierItem *item);
+
+    QString category() const;
+    QString id() const;
+    QString title() const;
+    QString status() const;
+    int windowId() const;
+    QString iconName() const;
+    DBusImageList iconPixmap() const;
+    DBusToolTip toolTip() const;
+    bool itemIsMenu() const;
+    QDBusObjectPath menu() const;
+
+public slots:
+    void ContextMenu(int x, int y);
+    void Activate(int x, int y);
+    void SecondaryActivate(int x, int y);
+    void Scroll(int delta, const QString &orientation);
+
+signals:
+    void NewTitle();
+    void NewIcon();
+    void NewToolTip();
+    void NewStatus(const QString &status);
+
+private:
+    StatusNotifierItem *m_item;
+};
+
+#endif // STATUSNOTIFIERITEM_H
@@ -0,0 +1,310 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "switchjournal.h"
+
+#include "metricsexporter.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
+
+namespace
+{
+struct JournalHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 used; // Bytes of records after the header
+    quint32 reserved;
+};
+
+constexpr quint32 s_magic = 0x4f4d514a; // "OMQJ"
+constexpr quint32 s_version = 1;
+constexpr quint32 s_capacity = 256 * 1024;
+
+SwitchJournal::Recorder *s_currentRecorder = nullptr;
+
+QString rotatedFilePath()
+{
+    return SwitchJournal::filePath() + QStringLiteral(".1");
+}
+
+void writeEntry(QDataStream &stream, const SwitchJournal::Entry &entry)
+{
+    stream << entry.timestamp << static_cast<quint8>(entry.operation) << entry.mode << static_cast<quint32>(entry.phases.size());
+    for (const SwitchJournal::Phase &phase : entry.phases)
+        stream << phase.name << static_cast<quint8>(phase.result) << phase.duration << phase.decisionWait;
+    stream << static_cast<quint8>(entry.outcome) << entry.sendError << entry.logoutMethod;
+}
+
+bool readEntry(QDataStream &stream, SwitchJournal::Entry &entry)
+{
+    quint8 operation;
+    quint32 phasesCount;
+    stream >> entry.timestamp >> operation >> entry.mode >> phasesCount;
+    entry.operation = static_cast<SwitchJournal::Operation>(operation);
+
+    for (quint32 i = 0; i < phasesCount && stream.status() == QDataStream::Ok; ++i) {
+        SwitchJournal::Phase phase;
+        quint8 result;
+        stream >> phase.name >> result >> phase.duration >> phase.decisionWait;
+        phase.result = static_cast<SwitchJournal::Result>(result);
+        entry.phases.append(phase);
+    }
+
+    quint8 outcome;
+    stream >> outcome >> entry.sendError >> entry.logoutMethod;
+    entry.outcome = static_cast<SwitchJournal::Result>(outcome);
+    return stream.status() == QDataStream::Ok;
+}
+
+// Maps the whole journal file, initializes it if it is new or invalid
+uchar *mapJournal(QFile &journalFile)
+{
+    if (journalFile.size() != s_capacity && !journalFile.resize(s_capacity)) {
+        qWarning("Unable to resize switch journal %s: %s", qPrintable(journalFile.fileName()), qPrintable(journalFile.errorString()));
+        return nullptr;
+    }
+
+    uchar *data = journalFile.map(0, s_capacity);
+    if (data == nullptr) {
+        qWarning("Unable to map switch journal %s: %s", qPrintable(journalFile.fileName()), qPrintable(journalFile.errorString()));
+        return nullptr;
+    }
+
+    JournalHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != s_magic || header.version != s_version || sizeof(header) + header.used > s_capacity) {
+        header = {s_magic, s_version, 0, 0};
+        std::memcpy(data, &header, sizeof(header));
+    }
+
+    return data;
+}
+
+void readJournal(const QString &path, QVector<SwitchJournal::Entry> &entries)
+{
+    QFile journalFile(path);
+    if (!journalFile.open(QIODevice::ReadOnly) || journalFile.size() < static_cast<qint64>(sizeof(JournalHeader)))
+        return;
+
+    uchar *data = journalFile.map(0, journalFile.size());
+    if (data == nullptr)
+        return;
+
+    JournalHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic == s_magic && header.version == s_version && sizeof(header) + header.used <= static_cast<quint64>(journalFile.size())) {
+        const uchar *records = data + sizeof(header);
+        quint32 offset = 0;
+        while (offset + sizeof(quint32) <= header.used) {
+            quint32 recordSize;
+            std::memcpy(&recordSize, records + offset, sizeof(recordSize));
+            offset += sizeof(recordSize);
+            if (recordSize > header.used - offset)
+                break;
+
+            const QByteArray record = QByteArray::fromRawData(reinterpret_cast<const char *>(records + offset), static_cast<int>(recordSize));
+            QDataStream stream(record);
+            stream.setVersion(QDataStream::Qt_5_10);
+            SwitchJournal::Entry entry;
+            if (readEntry(stream, entry))
+                entries.append(entry);
+
+            offset += recordSize;
+        }
+    }
+
+    journalFile.unmap(data);
+}
+}
+
+SwitchJournal::Recorder::Recorder(Operation operation, const QString &mode)
+    : m_previous(s_currentRecorder)
+{
+    m_entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+    m_entry.operation = operation;
+    m_entry.mode = mode;
+    s_currentRecorder = this;
+}
+
+SwitchJournal::Recorder::~Recorder()
+{
+    endPhase();
+    for (const Phase &phase : qAsConst(m_entry.phases)) {
+        if (phase.result == Cancelled || phase.result == Failed) {
+            m_entry.outcome = phase.result;
+            break;
+        }
+    }
+
+    s_currentRecorder = m_previous;
+    append(m_entry);
+    MetricsExporter::addOutcome(m_entry);
+}
+
+void SwitchJournal::Recorder::beginPhase(const QString &name)
+{
+    endPhase();
+    m_phase.name = name;
+    m_phaseTimer.start();
+}
+
+void SwitchJournal::Recorder::setResult(Result result)
+{
+    m_phase.result = result;
+}
+
+void SwitchJournal::Recorder::setSendError(const QString &error)
+{
+    m_entry.sendError = error;
+}
+
+void SwitchJournal::Recorder::setLogoutMethod(const QString &method)
+{
+    m_entry.logoutMethod = method;
+}
+
+SwitchJournal::Recorder *SwitchJournal::Recorder::current()
+{
+    return s_currentRecorder;
+}
+
+void SwitchJournal::Recorder::addDecisionWait(qint64 duration)
+{
+    m_phase.decisionWait += duration;
+}
+
+void SwitchJournal::Recorder::endPhase()
+{
+    if (m_phase.name.isEmpty())
+        return;
+
+    m_phase.duration = m_phaseTimer.nsecsElapsed() / 1000;
+    m_entry.phases.append(m_phase);
+    m_phase = {};
+}
+
+void SwitchJournal::append(const Entry &entry)
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_10);
+    writeEntry(stream, entry);
+
+    const quint32 recordSize = static_cast<quint32>(record.size());
+    if (sizeof(JournalHeader) + sizeof(recordSize) + recordSize > s_capacity) {
+        qWarning("Switch journal record is too large: %u bytes", recordSize);
+        return;
+    }
+
+    const QString path = filePath();
+    if (!QDir().mkpath(QFileInfo(path).path())) {
+        qWarning("Unable to create directory for switch journal %s", qPrintable(path));
+        return;
+    }
+
+    QFile journalFile(path);
+    if (!journalFile.open(QIODevice::ReadWrite)) {
+        qWarning("Unable to open switch journal %s: %s", qPrintable(path), qPrintable(journalFile.errorString()));
+        return;
+    }
+
+    uchar *data = mapJournal(journalFile);
+    if (data == nullptr)
+        return;
+
+    JournalHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    // Start a new file when the record does not fit, keeping only the previous one
+    if (sizeof(header) + header.used + sizeof(recordSize) + recordSize > s_capacity) {
+        journalFile.unmap(data);
+        journalFile.close();
+        QFile::remove(rotatedFilePath());
+        if (!QFile::rename(path, rotatedFilePath()) || !journalFile.open(QIODevice::ReadWrite)) {
+            qWarning("Unable to rotate switch journal %s", qPrintable(path));
+            return;
+        }
+
+        data = mapJournal(journalFile);
+        if (data == nullptr)
+            return;
+        std::memcpy(&header, data, sizeof(header));
+    }
+
+    // Write the record first, so an interrupted append is never visible
+    uchar *end = data + sizeof(header) + header.used;
+    std::memcpy(end, &recordSize, sizeof(recordSize));
+    std::memcpy(end + sizeof(recordSize), record.constData(), recordSize);
+    header.used += sizeof(recordSize) + recordSize;
+    std::memcpy(data, &header, sizeof(header));
+
+    journalFile.unmap(data);
+}
+
+QVector<SwitchJournal::Entry> SwitchJournal::entries()
+{
+    QVector<Entry> entries;
+    readJournal(rotatedFilePath(), entries);
+    readJournal(filePath(), entries);
+    return entries;
+}
+
+QString SwitchJournal::filePath()
+{
+    QString stateHome = qEnvironmentVariable("XDG_STATE_HOME");
+    if (stateHome.isEmpty())
+        stateHome = QDir::homePath() + QStringLiteral("/.local/state");
+
+    return QStringLiteral("%1/%2/%3/switch-journal").arg(stateHome, QCoreApplication::organizationName(), QCoreApplication::applicationName());
+}
+
+QString SwitchJournal::operationString(Operation operation)
+{
+    switch (operation) {
+    case Switch:
+        return QStringLiteral("switch");
+    case ConfigApply:
+        return QStringLiteral("config-apply");
+    }
+
+    return QStringLiteral("unknown");
+}
+
+QString SwitchJournal::resultString(Result result)
+{
+    switch (result) {
+    case Passed:
+        return QStringLiteral("passed");
+    case Warned:
+        return QStringLiteral("warned");
+    case Cancelled:
+        return QStringLiteral("cancelled");
+    case Failed:
+        return QStringLiteral("failed");
+    }
+
+    return QStringLiteral("unknown");
+}
@@ -0,0 +1,97 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SWITCHJOURNAL_H
+#define SWITCHJOURNAL_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+// Append-only binary log of switch attempts and configuration applies stored in the user state directory.
+// Records are written into a memory-mapped file of bounded size, the previous file is kept after rotation.
+namespace SwitchJournal
+{
+enum Operation : quint8 {
+    Switch,
+    ConfigApply
+};
+
+enum Result : quint8 {
+    Passed,
+    Warned,
+    Cancelled,
+    Failed
+};
+
+// Durations are in microseconds
+struct Phase {
+    QString name;
+    Result result = Passed;
+    qint64 duration = 0;
+    qint64 decisionWait = 0;
+};
+
+struct Entry {
+    qint64 timestamp = 0; // Milliseconds since epoch
+    Operation operation = Switch;
+    QString mode; // Requested mode or configuration type
+    QVector<Phase> phases;
+    Result outcome = Passed;
+    QString sendError;
+    QString logoutMethod;
+};
+
+// Collects phases of the current operation and appends the entry on destruction
+class Recorder
+{
+    Q_DISABLE_COPY(Recorder)
+
+public:
+    Recorder(Operation operation, const QString &mode);
+    ~Recorder();
+
+    // Ends the previous phase
+    void beginPhase(const QString &name);
+    void setResult(Result result);
+    void setSendError(const QString &error);
+    void setLogoutMethod(const QString &method);
+
+    // Returns the innermost recorder, used to account time spent in message boxes
+    static Recorder *current();
+    void addDecisionWait(qint64 duration);
+
+private:
+    void endPhase();
+
+    Entry m_entry;
+    Phase m_phase;
+    QElapsedTimer m_phaseTimer;
+    Recorder *m_previous;
+};
+
+void append(const Entry &entry);
+QVector<Entry> entries();
+
+QString filePath();
+QString operationString(Operation operation);
+QString resultString(Result result);
+}
+
+#endif // SWITCHJOURNAL_H
@@ -0,0 +1,146 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "switchlatency.h"
+
+#include "cmake.h"
+#include "systempaths.h"
+#include "settings/appsettings.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <array>
+#include <unistd.h>
+
+namespace
+{
+// Upper bounds of histogram buckets in seconds, the last bucket is unbounded
+constexpr std::array<int, 7> s_bucketBounds = {5, 10, 20, 30, 60, 120, 300};
+
+qint64 bootTime()
+{
+    QFile statFile(SystemPaths::procDir() + QStringLiteral("/stat"));
+    if (!statFile.open(QIODevice::ReadOnly))
+        return -1;
+
+    while (!statFile.atEnd()) {
+        const QByteArray line = statFile.readLine();
+        if (line.startsWith("btime "))
+            return line.mid(6).trimmed().toLongLong();
+    }
+
+    return -1;
+}
+
+// Returns process start time in clock ticks after boot
+qint64 processStartTicks(const QString &processDir)
+{
+    QFile statFile(processDir + QStringLiteral("/stat"));
+    if (!statFile.open(QIODevice::ReadOnly))
+        return -1;
+
+    // Process name can contain spaces, so fields are counted after its closing parenthesis starting from the 3rd field
+    const QByteArray stat = statFile.readAll();
+    const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 20)
+        return -1;
+
+    return fields.at(19).toLongLong();
+}
+}
+
+QDateTime SwitchLatency::xorgStartTime()
+{
+    qint64 newestStart = -1;
+    for (QDirIterator it(SystemPaths::procDir(), QDir::NoDotAndDotDot | QDir::Dirs); it.hasNext();) {
+        const QString processDir = it.next();
+
+        QFile commFile(processDir + QStringLiteral("/comm"));
+        if (!commFile.open(QIODevice::ReadOnly))
+            continue;
+
+        const QByteArray name = commFile.readLine().trimmed();
+        if (name != "Xorg" && name != "X")
+            continue;
+
+        newestStart = qMax(newestStart, processStartTicks(processDir));
+    }
+
+    const qint64 boot = bootTime();
+    if (newestStart == -1 || boot == -1)
+        return {};
+
+    return QDateTime::fromMSecsSinceEpoch(boot * 1000 + newestStart * 1000 / sysconf(_SC_CLK_TCK));
+}
+
+void SwitchLatency::addLatency(qint64 latency)
+{
+    AppSettings appSettings;
+    AppSettings::SwitchLatencyStats stats = appSettings.switchLatencyStats();
+    stats.buckets.resize(s_bucketBounds.size() + 1);
+
+    const auto bound = std::find_if(s_bucketBounds.cbegin(), s_bucketBounds.cend(), [latency](int upperBound) {
+        return latency <= upperBound * 1000;
+    });
+    ++stats.buckets[static_cast<int>(bound - s_bucketBounds.cbegin())];
+    stats.sum += latency;
+
+    appSettings.setSwitchLatencyStats(stats);
+}
+
+void SwitchLatency::addMismatch()
+{
+    AppSettings appSettings;
+    AppSettings::SwitchLatencyStats stats = appSettings.switchLatencyStats();
+    ++stats.mismatches;
+    appSettings.setSwitchLatencyStats(stats);
+}
+
+QString SwitchLatency::exportMetrics()
+{
+    AppSettings::SwitchLatencyStats stats = AppSettings().switchLatencyStats();
+    stats.buckets.resize(s_bucketBounds.size() + 1);
+
+    QString metrics;
+    QTextStream stream(&metrics);
+    const QString name = QStringLiteral(PROJECT_NAME "_switch_latency_seconds").replace('-', '_');
+    stream << "# HELP " << name << " Time from switch request to start of the new X session.\n";
+    stream << "# TYPE " << name << " histogram\n";
+
+    int count = 0;
+    for (size_t i = 0; i < s_bucketBounds.size(); ++i) {
+        count += stats.buckets.at(static_cast<int>(i));
+        stream << name << "_bucket{le=\"" << s_bucketBounds[i] << "\"} " << count << '\n';
+    }
+    count += stats.buckets.constLast();
+    stream << name << "_bucket{le=\"+Inf\"} " << count << '\n';
+    stream << name << "_sum " << static_cast<double>(stats.sum) / 1000 << '\n';
+    stream << name << "_count " << count << '\n';
+
+    const QString mismatchesName = QStringLiteral(PROJECT_NAME "_switch_mismatches_total").replace('-', '_');
+    stream << "# HELP " << mismatchesName << " Switches after which a different mode was active.\n";
+    stream << "# TYPE " << mismatchesName << " counter\n";
+    stream << mismatchesName << ' ' << stats.mismatches << '\n';
+
+    stream.flush();
+    return metrics;
+}
@@ -0,0 +1,145 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "systemfactscache.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <sys/stat.h>
+
+namespace
+{
+constexpr quint32 s_magic = 0x4f4d5146; // "OMQF"
+constexpr quint32 s_version = 1;
+}
+
+bool SystemFactsCache::SourceIdentity::operator==(const SourceIdentity &other) const
+{
+    return device == other.device && inode == other.inode && size == other.size && modificationTime == other.modificationTime;
+}
+
+SystemFactsCache &SystemFactsCache::instance()
+{
+    static SystemFactsCache cache;
+    return cache;
+}
+
+QVariant SystemFactsCache::value(const QString &key, const QString &sourcePath, const std::function<QVariant()> &compute)
+{
+    const SourceIdentity source = sourceIdentity(sourcePath);
+
+    const QMutexLocker locker(&m_mutex);
+    if (auto it = m_facts.constFind(key); it != m_facts.constEnd() && it->source == source)
+        return it->value;
+
+    const QVariant value = compute();
+    m_facts.insert(key, {source, value});
+    save();
+    return value;
+}
+
+SystemFactsCache::SystemFactsCache()
+{
+    load();
+}
+
+void SystemFactsCache::load()
+{
+    QFile cacheFile(cacheFilePath());
+    if (!cacheFile.open(QIODevice::ReadOnly) || cacheFile.size() == 0)
+        return;
+
+    // Map the file to read it without copying into a buffer first
+    uchar *data = cacheFile.map(0, cacheFile.size());
+    if (data == nullptr)
+        return;
+
+    const QByteArray rawData = QByteArray::fromRawData(reinterpret_cast<const char *>(data), static_cast<int>(cacheFile.size()));
+    QDataStream stream(rawData);
+    stream.setVersion(QDataStream::Qt_5_10);
+
+    quint32 magic;
+    quint32 version;
+    quint32 count;
+    stream >> magic >> version >> count;
+    if (magic != s_magic || version != s_version) {
+        cacheFile.unmap(data);
+        return;
+    }
+
+    m_facts.reserve(static_cast<int>(count));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString key;
+        Fact fact;
+        stream >> key >> fact.source.device >> fact.source.inode >> fact.source.size >> fact.source.modificationTime >> fact.value;
+        if (stream.status() == QDataStream::Ok)
+            m_facts.insert(key, fact);
+    }
+
+    cacheFile.unmap(data);
+}
+
+// Should be called with locked mutex
+void SystemFactsCache::save() const
+{
+    const QString path = cacheFilePath();
+    if (!QDir().mkpath(QFileInfo(path).path())) {
+        qWarning("Unable to create directory for system facts cache %s", qPrintable(path));
+        return;
+    }
+
+    QSaveFile cacheFile(path);
+    if (!cacheFile.open(QIODevice::WriteOnly)) {
+        qWarning("Unable to open system facts cache %s: %s", qPrintable(path), qPrintable(cacheFile.errorString()));
+        return;
+    }
+
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_5_10);
+    stream << s_magic << s_version << static_cast<quint32>(m_facts.size());
+    for (auto it = m_facts.cbegin(); it != m_facts.cend(); ++it)
+        stream << it.key() << it->source.device << it->source.inode << it->source.size << it->source.modificationTime << it->value;
+
+    if (!cacheFile.commit())
+        qWarning("Unable to write system facts cache %s: %s", qPrintable(path), qPrintable(cacheFile.errorString()));
+}
+
+SystemFactsCache::SourceIdentity SystemFactsCache::sourceIdentity(const QString &path)
+{
+    struct stat fileStat = {};
+    if (stat(QFile::encodeName(path).constData(), &fileStat) == -1)
+        return {};
+
+    SourceIdentity identity;
+    identity.device = fileStat.st_dev;
+    identity.inode = fileStat.st_ino;
+    identity.size = fileStat.st_size;
+    identity.modificationTime = static_cast<qint64>(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+    return identity;
+}
+
+QString SystemFactsCache::cacheFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/system-facts.bin");
+}
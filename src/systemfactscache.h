@@ -0,0 +1,68 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYSTEMFACTSCACHE_H
+#define SYSTEMFACTSCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QVariant>
+
+#include <functional>
+
+// Persistent cache for values derived from slow-changing system files (display manager unit, modules.dep etc.).
+// Each value is bound to the identity of its source file and recomputed only after the file was changed.
+class SystemFactsCache
+{
+    Q_DISABLE_COPY(SystemFactsCache)
+
+public:
+    static SystemFactsCache &instance();
+
+    QVariant value(const QString &key, const QString &sourcePath, const std::function<QVariant()> &compute);
+
+private:
+    // Identity of a source file, all fields are zero if file does not exist
+    struct SourceIdentity {
+        quint64 device = 0;
+        quint64 inode = 0;
+        qint64 size = 0;
+        qint64 modificationTime = 0;
+
+        bool operator==(const SourceIdentity &other) const;
+    };
+
+    struct Fact {
+        SourceIdentity source;
+        QVariant value;
+    };
+
+    SystemFactsCache();
+
+    void load();
+    void save() const;
+
+    static SourceIdentity sourceIdentity(const QString &path);
+    static QString cacheFilePath();
+
+    QMutex m_mutex;
+    QHash<QString, Fact> m_facts;
+};
+
+#endif // SYSTEMFACTSCACHE_H
@@ -0,0 +1,123 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "systempaths.h"
+
+#include <QDir>
+
+namespace
+{
+QString s_root = SystemPaths::rootFromEnvironment();
+}
+
+QString SystemPaths::root()
+{
+    return s_root;
+}
+
+void SystemPaths::setRoot(const QString &root)
+{
+    // Store without trailing slash to simply prepend it to absolute paths
+    s_root = root.isEmpty() ? QString() : QDir::cleanPath(root);
+    if (s_root == QLatin1String("/"))
+        s_root.clear();
+}
+
+QString SystemPaths::rootFromEnvironment()
+{
+    const QString root = qEnvironmentVariable("OPTIMUS_MANAGER_QT_SYSROOT");
+    if (root.isEmpty() || root == QLatin1String("/"))
+        return {};
+
+    return QDir::cleanPath(root);
+}
+
+QString SystemPaths::resolve(const QString &absolutePath)
+{
+    Q_ASSERT(absolutePath.startsWith('/'));
+    return s_root + absolutePath;
+}
+
+QString SystemPaths::stateFile()
+{
+    return resolve(QStringLiteral("/var/lib/optimus-manager/tmp/state.json"));
+}
+
+QString SystemPaths::modulesDepFile(const QString &kernelVersion)
+{
+    return resolve(QStringLiteral("/lib/modules/%1/modules.dep").arg(kernelVersion));
+}
+
+QString SystemPaths::xorgConfigFile()
+{
+    return resolve(QStringLiteral("/etc/X11/xorg.conf"));
+}
+
+QString SystemPaths::mhwdConfigFile()
+{
+    return resolve(QStringLiteral("/etc/X11/xorg.conf.d/90-mhwd.conf"));
+}
+
+QString SystemPaths::xorgDriverFile(const QString &driverName)
+{
+    return resolve(QStringLiteral("/usr/lib/xorg/modules/drivers/%1_drv.so").arg(driverName));
+}
+
+QStringList SystemPaths::gdmPrimeDirs()
+{
+    return {resolve(QStringLiteral("/etc/gdm/Prime")), resolve(QStringLiteral("/etc/gdm3/Prime"))};
+}
+
+QString SystemPaths::displayManagerServiceFile()
+{
+    return resolve(QStringLiteral("/etc/systemd/system/display-manager.service"));
+}
+
+QString SystemPaths::runitServiceFile()
+{
+    return resolve(QStringLiteral("/var/service/optimus-manager/run"));
+}
+
+QString SystemPaths::optimusManagerExecutable()
+{
+    return resolve(QStringLiteral("/usr/bin/optimus-manager"));
+}
+
+QString SystemPaths::procDir()
+{
+    return resolve(QStringLiteral("/proc"));
+}
+
+// Resolved, so runs against a synthetic tree never reach the real daemon
+QString SystemPaths::daemonSocket()
+{
+    return resolve(QStringLiteral("/tmp/optimus-manager"));
+}
+
+// Written by the daemon and contains a path in the real filesystem
+QString SystemPaths::tempConfigPathFile()
+{
+    return QStringLiteral("/var/lib/optimus-manager/temp_conf_path");
+}
+
+// Passed to the daemon, which reads it from the real filesystem
+QString SystemPaths::permanentConfigFile()
+{
+    return QStringLiteral("/etc/optimus-manager/optimus-manager.conf");
+}
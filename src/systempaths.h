@@ -0,0 +1,53 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYSTEMPATHS_H
+#define SYSTEMPATHS_H
+
+#include <QStringList>
+
+// All system paths that are probed by the application.
+// Paths are resolved against a configurable root (empty by default),
+// which allows to point probes to a synthetic filesystem tree.
+// Configuration paths are shared with the daemon, so they are never resolved.
+namespace SystemPaths
+{
+QString root();
+void setRoot(const QString &root);
+QString rootFromEnvironment();
+
+QString resolve(const QString &absolutePath);
+
+QString stateFile();
+QString modulesDepFile(const QString &kernelVersion);
+QString xorgConfigFile();
+QString mhwdConfigFile();
+QString xorgDriverFile(const QString &driverName);
+QStringList gdmPrimeDirs();
+QString displayManagerServiceFile();
+QString runitServiceFile();
+QString optimusManagerExecutable();
+QString procDir();
+QString daemonSocket();
+
+QString tempConfigPathFile();
+QString permanentConfigFile();
+}
+
+#endif // SYSTEMPATHS_H
@@ -0,0 +1,126 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tracescope.h"
+
+#include "cmake.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+
+namespace
+{
+struct TraceEvent {
+    const char *name;
+    QString detail;
+    qint64 begin;
+    qint64 duration;
+    quintptr threadId;
+};
+
+QElapsedTimer startedClock()
+{
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+const QString s_tracePath = qEnvironmentVariable("OPTIMUS_MANAGER_QT_TRACE");
+const bool s_enabled = !s_tracePath.isEmpty();
+const QElapsedTimer s_clock = startedClock();
+
+QMutex s_eventsMutex;
+QVector<TraceEvent> s_events; // Pending until the outermost scope ends
+QFile s_traceFile;
+bool s_traceFileFailed = false;
+thread_local int s_depth = 0;
+
+// Should be called with locked mutex.
+// The closing bracket is never written, Chrome trace viewers accept the array without it.
+void flushEvents()
+{
+    if (!s_traceFile.isOpen() && !s_traceFileFailed) {
+        s_traceFile.setFileName(s_tracePath);
+        if (s_traceFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            s_traceFile.write("[\n");
+        } else {
+            qWarning("Unable to open trace file %s: %s", qPrintable(s_tracePath), qPrintable(s_traceFile.errorString()));
+            s_traceFileFailed = true;
+        }
+    }
+
+    if (s_traceFileFailed) {
+        s_events.clear();
+        return;
+    }
+
+    for (const TraceEvent &event : qAsConst(s_events)) {
+        QJsonObject traceEvent{
+            {QStringLiteral("name"), QLatin1String(event.name)},
+            {QStringLiteral("cat"), QStringLiteral(PROJECT_NAME)},
+            {QStringLiteral("ph"), QStringLiteral("X")},
+            {QStringLiteral("ts"), static_cast<double>(event.begin) / 1000},
+            {QStringLiteral("dur"), static_cast<double>(event.duration) / 1000},
+            {QStringLiteral("pid"), QCoreApplication::applicationPid()},
+            {QStringLiteral("tid"), static_cast<qint64>(event.threadId)},
+        };
+        if (!event.detail.isEmpty())
+            traceEvent.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("detail"), event.detail}});
+        s_traceFile.write(QJsonDocument(traceEvent).toJson(QJsonDocument::Compact) + ",\n");
+    }
+
+    if (!s_traceFile.flush())
+        qWarning("Unable to write trace file %s: %s", qPrintable(s_tracePath), qPrintable(s_traceFile.errorString()));
+    s_events.clear();
+}
+}
+
+TraceScope::TraceScope(const char *name, const QString &detail)
+    : m_name(name)
+{
+    if (!s_enabled)
+        return;
+
+    m_detail = detail;
+    m_begin = s_clock.nsecsElapsed();
+    ++s_depth;
+}
+
+TraceScope::~TraceScope()
+{
+    if (m_begin == -1)
+        return;
+
+    const qint64 duration = s_clock.nsecsElapsed() - m_begin;
+    const QMutexLocker locker(&s_eventsMutex);
+    s_events.append({m_name, m_detail, m_begin, duration, reinterpret_cast<quintptr>(QThread::currentThreadId())});
+    if (--s_depth == 0)
+        flushEvents();
+}
+
+bool TraceScope::isEnabled()
+{
+    return s_enabled;
+}
@@ -0,0 +1,57 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACESCOPE_H
+#define TRACESCOPE_H
+
+#include <QString>
+
+#include <type_traits>
+
+// Records duration of the enclosing scope as a Chrome trace event.
+// Enabled only when OPTIMUS_MANAGER_QT_TRACE contains path to the output file,
+// otherwise construction and destruction are only a flag check.
+// Events are appended to the file in JSON array format each time an outermost scope ends.
+class TraceScope
+{
+    Q_DISABLE_COPY(TraceScope)
+
+public:
+    explicit TraceScope(const char *name, const QString &detail = {});
+
+    // Detail is computed only when tracing is enabled
+    template <typename Detail, typename = std::enable_if_t<std::is_invocable_r_v<QString, Detail>>>
+    TraceScope(const char *name, Detail detail)
+        : TraceScope(name)
+    {
+        if (m_begin != -1)
+            m_detail = detail();
+    }
+
+    ~TraceScope();
+
+    static bool isEnabled();
+
+private:
+    const char *m_name;
+    QString m_detail;
+    qint64 m_begin = -1;
+};
+
+#endif // TRACESCOPE_H
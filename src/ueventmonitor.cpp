@@ -0,0 +1,83 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ueventmonitor.h"
+
+#include <QSocketNotifier>
+
+#include <cstring>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+UeventMonitor::UeventMonitor(QObject *parent)
+    : QObject(parent)
+{
+    m_socketFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (m_socketFd == -1) {
+        qWarning("Unable to create uevent socket: %s", strerror(errno));
+        return;
+    }
+
+    sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1; // Kernel events
+    if (bind(m_socketFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == -1) {
+        qWarning("Unable to listen to uevents: %s", strerror(errno));
+        close(m_socketFd);
+        m_socketFd = -1;
+        return;
+    }
+
+    m_notifier = new QSocketNotifier(m_socketFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &UeventMonitor::readUevent);
+}
+
+UeventMonitor::~UeventMonitor()
+{
+    if (m_socketFd != -1)
+        close(m_socketFd);
+}
+
+void UeventMonitor::readUevent()
+{
+    // Message is "action@devpath" followed by null-terminated "KEY=value" pairs
+    char buffer[8192];
+    ssize_t size;
+    while ((size = recv(m_socketFd, buffer, sizeof(buffer) - 1, 0)) > 0) {
+        buffer[size] = '\0'; // Make sure that the last field is terminated
+        const char *end = buffer + size;
+        const char *header = buffer;
+        const char *headerEnd = static_cast<const char *>(std::memchr(header, '@', static_cast<size_t>(size)));
+        if (headerEnd == nullptr)
+            continue;
+
+        const QByteArray action(header, static_cast<int>(headerEnd - header));
+        QByteArray subsystem;
+        for (const char *field = header + std::strlen(header) + 1; field < end; field += std::strlen(field) + 1) {
+            constexpr char subsystemKey[] = "SUBSYSTEM=";
+            if (std::strncmp(field, subsystemKey, sizeof(subsystemKey) - 1) == 0) {
+                subsystem = field + sizeof(subsystemKey) - 1;
+                break;
+            }
+        }
+
+        emit ueventReceived(action, subsystem);
+    }
+}
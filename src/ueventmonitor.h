@@ -0,0 +1,48 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef UEVENTMONITOR_H
+#define UEVENTMONITOR_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+// Listens to kernel uevents on a netlink socket
+class UeventMonitor : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(UeventMonitor)
+
+public:
+    explicit UeventMonitor(QObject *parent = nullptr);
+    ~UeventMonitor() override;
+
+signals:
+    void ueventReceived(const QByteArray &action, const QByteArray &subsystem);
+
+private slots:
+    void readUevent();
+
+private:
+    int m_socketFd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+};
+
+#endif // UEVENTMONITOR_H
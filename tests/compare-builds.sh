@@ -0,0 +1,29 @@
+#!/bin/sh
+# Builds the project with several option sets and compares tray startup, idle memory and binary sizes.
+# Usage: compare-builds.sh <source dir> <work dir> <runs> <name>=<cmake options>...
+
+set -eu
+
+source_dir=$1
+work_dir=$2
+runs=$3
+shift 3
+
+for variant in "$@"; do
+    name=${variant%%=*}
+    options=${variant#*=}
+    build_dir=$work_dir/$name
+
+    # Options are split on spaces intentionally
+    # shellcheck disable=SC2086
+    cmake -S "$source_dir" -B "$build_dir" -DCMAKE_BUILD_TYPE=Release -DBUILD_BENCHMARKS=ON $options >/dev/null
+    cmake --build "$build_dir" --target optimus-manager-qt mock-status-notifier-watcher >/dev/null
+
+    application=$build_dir/optimus-manager-qt
+    summary=$("$(dirname "$0")/tray-benchmark.sh" "$application" "$build_dir/tests/mock-status-notifier-watcher" "$name" "$runs")
+    modules_size=0
+    for module in "$build_dir"/*.so; do
+        [ -e "$module" ] && modules_size=$((modules_size + $(stat -c %s "$module")))
+    done
+    echo "$summary executable_bytes=$(stat -c %s "$application") modules_bytes=$modules_size"
+done
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Applies a configuration through the daemon socket in a synthetic tree and verifies what the daemon receives.
+# Usage: config-fd.sh <application> <mock daemon socket> [preloaded library]
+# With a preloaded library sending the descriptor is expected to fail and the inline command to be used.
+
+set -eu
+
+application=$1
+mock_socket=$2
+preload=${3:-}
+
+workdir=$(mktemp -d)
+mock_pid=
+cleanup() {
+    [ -n "$mock_pid" ] && kill "$mock_pid" 2>/dev/null
+    rm -rf "$workdir"
+}
+trap cleanup EXIT
+
+mkdir -p "$workdir/sysroot/tmp"
+socket=$workdir/sysroot/tmp/optimus-manager
+config=$workdir/optimus-manager.conf
+printf '[optimus]\nswitching=none\npci_power_control=no\n\n[nvidia]\nmodeset=yes\nDPI=96\n' >"$config"
+
+if [ -n "$preload" ]; then
+    "$mock_socket" --inline "$socket" "$config" >"$workdir/received" &
+else
+    "$mock_socket" "$socket" "$config" >"$workdir/received" &
+fi
+mock_pid=$!
+while [ ! -S "$socket" ]; do
+    kill -0 "$mock_pid" 2>/dev/null || exit 1
+    sleep 0.1
+done
+
+export XDG_CONFIG_HOME="$workdir/config" OPTIMUS_MANAGER_QT_CONFIG_FD=1
+if [ -n "$preload" ]; then
+    LD_PRELOAD=$preload "$application" --sysroot "$workdir/sysroot" --apply-config "$config"
+else
+    "$application" --sysroot "$workdir/sysroot" --apply-config "$config"
+fi
+
+wait "$mock_pid"
+mock_pid=
+cat "$workdir/received"
@@ -0,0 +1,99 @@
+#!/bin/sh
+# Creates a synthetic system tree for --sysroot: Intel and Nvidia GPUs in Hybrid mode,
+# a battery, a large modules.dep and many processes in /proc.
+# Usage: generate-sysroot.sh <directory> [modules.dep entries] [processes]
+
+set -eu
+
+root=$1
+modules=${2:-6000}
+processes=${3:-2000}
+
+# Only trees created by this script are replaced
+if [ -d "$root" ] && [ -n "$(ls -A "$root")" ]; then
+    if [ ! -e "$root/.synthetic-sysroot" ]; then
+        echo "$root is not empty and was not generated by this script" >&2
+        exit 1
+    fi
+    rm -rf "$root"
+fi
+mkdir -p "$root"
+touch "$root/.synthetic-sysroot"
+
+# Usage: pci_gpu <address> <vendor id> <boot vga> <driver>
+pci_gpu() {
+    device=$root/sys/bus/pci/devices/$1
+    mkdir -p "$device/power" "$root/sys/bus/pci/drivers/$4"
+    echo "$2" >"$device/vendor"
+    echo 0x030000 >"$device/class"
+    echo "$3" >"$device/boot_vga"
+    echo "8.0 GT/s PCIe" >"$device/current_link_speed"
+    echo 16 >"$device/current_link_width"
+    echo active >"$device/power/runtime_status"
+    ln -s "../../drivers/$4" "$device/driver"
+}
+
+# Usage: drm_node <node> <pci address>
+drm_node() {
+    mkdir -p "$root/sys/class/drm/$1"
+    ln -s "../../../bus/pci/devices/$2" "$root/sys/class/drm/$1/device"
+}
+
+pci_gpu 0000:00:02.0 0x8086 1 i915
+pci_gpu 0000:01:00.0 0x10de 0 nvidia
+drm_node card0 0000:00:02.0
+drm_node renderD128 0000:00:02.0
+drm_node card1 0000:01:00.0
+drm_node renderD129 0000:01:00.0
+
+mkdir -p "$root/sys/class/power_supply/BAT0" "$root/sys/class/power_supply/AC"
+echo Battery >"$root/sys/class/power_supply/BAT0/type"
+echo 12000000 >"$root/sys/class/power_supply/BAT0/power_now"
+echo Mains >"$root/sys/class/power_supply/AC/type"
+echo 0 >"$root/sys/class/power_supply/AC/online"
+
+mkdir -p "$root/var/lib/optimus-manager/tmp"
+echo '{"current_mode": "hybrid"}' >"$root/var/lib/optimus-manager/tmp/state.json"
+
+mkdir -p "$root/etc/systemd/system" "$root/etc/X11/xorg.conf.d"
+printf '[Service]\nExecStart=/usr/bin/sddm\n' >"$root/etc/systemd/system/display-manager.service"
+
+mkdir -p "$root/usr/bin" "$root/usr/lib/xorg/modules/drivers"
+touch "$root/usr/lib/xorg/modules/drivers/intel_drv.so"
+printf '#!/bin/sh\n' >"$root/usr/bin/optimus-manager"
+chmod +x "$root/usr/bin/optimus-manager"
+
+# Searched modules are placed last, so the whole file is read
+modules_dir=$root/lib/modules/$(uname -r)
+mkdir -p "$modules_dir"
+awk -v count="$modules" 'BEGIN {
+    for (i = 0; i < count; ++i)
+        printf "kernel/drivers/misc/module%d.ko.zst: kernel/lib/dependency%d.ko.zst\n", i, i % 50
+    print "kernel/drivers/acpi/bbswitch.ko.zst:"
+    print "kernel/drivers/video/nvidia.ko.zst:"
+}' >"$modules_dir/modules.dep"
+
+# Every tenth process renders on the discrete GPU, the first one is the X server.
+# Process IDs start above the kernel limit, so they never match the scanning process.
+mkdir -p "$root/proc"
+echo "btime 1700000000" >"$root/proc/stat"
+first_pid=5000000
+pid=$first_pid
+last_pid=$((pid + processes))
+while [ "$pid" -lt "$last_pid" ]; do
+    process=$root/proc/$pid
+    mkdir -p "$process/fd"
+    if [ "$pid" -eq "$first_pid" ]; then
+        name=Xorg
+    else
+        name=process$pid
+    fi
+    echo "$name" >"$process/comm"
+    printf '%s\0' "/usr/bin/$name" >"$process/cmdline"
+    echo "$pid ($name) S 1 $pid $pid 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 $pid 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0" >"$process/stat"
+    ln -s /dev/null "$process/fd/0"
+    if [ $((pid % 10)) -eq 0 ]; then
+        ln -s /dev/dri/renderD129 "$process/fd/3"
+    fi
+    pid=$((pid + 1))
+done
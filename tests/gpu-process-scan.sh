@@ -0,0 +1,44 @@
+#!/bin/sh
+# Measures /proc/*/fd scan for processes using the discrete GPU in a synthetic system tree.
+# Usage: gpu-process-scan.sh <application> <sysroot> <expected processes> <runs>
+
+set -eu
+
+application=$1
+sysroot=$2
+expected=$3
+runs=$4
+
+workdir=$(mktemp -d)
+trap 'rm -rf "$workdir"' EXIT
+
+XDG_CONFIG_HOME=$workdir/config
+export XDG_CONFIG_HOME
+
+run=0
+while [ "$run" -lt "$runs" ]; do
+    "$application" --scan-gpu-processes --sysroot "$sysroot" | tail -n 1 >>"$workdir/results"
+    run=$((run + 1))
+done
+
+awk -v expected="$expected" '
+{
+    for (i = 1; i <= NF; ++i) {
+        split($i, field, "=")
+        value[field[1]] = field[2]
+    }
+    if (value["processes"] != expected) {
+        printf "expected %d processes, got %d\n", expected, value["processes"]
+        failed = 1
+    }
+    duration = value["duration_us"] + 0
+    total += duration
+    if (NR == 1 || duration < min)
+        min = duration
+    if (duration > max)
+        max = duration
+}
+END {
+    printf "processes=%d runs=%d min_us=%d avg_us=%d max_us=%d\n", expected, NR, min, total / NR, max
+    exit failed
+}' "$workdir/results"
@@ -0,0 +1,164 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Receives a single daemon command on the datagram socket and verifies the sent configuration
+namespace
+{
+constexpr int allSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+constexpr size_t maxDatagramSize = 1024 * 1024;
+
+int fail(const QString &reason)
+{
+    QTextStream(stderr) << reason << '\n';
+    return 1;
+}
+
+QByteArray readDescriptor(int fd, qint64 size)
+{
+    QByteArray content(static_cast<int>(size), Qt::Uninitialized);
+    qint64 received = 0;
+    while (received < size) {
+        const ssize_t result = pread(fd, content.data() + received, static_cast<size_t>(size - received), received);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return {};
+        received += result;
+    }
+    return content;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption inlineOption(QStringLiteral("inline"), QStringLiteral("Expect inline user_config command instead of user_config_fd."));
+    parser.addOption(inlineOption);
+    parser.addPositionalArgument(QStringLiteral("socket"), QStringLiteral("Path of the socket to bind."));
+    parser.addPositionalArgument(QStringLiteral("expected"), QStringLiteral("File with the expected configuration content."));
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 2)
+        parser.showHelp(1);
+
+    QFile expectedFile(arguments.at(1));
+    if (!expectedFile.open(QIODevice::ReadOnly))
+        return fail(QStringLiteral("Unable to read %1: %2").arg(expectedFile.fileName(), expectedFile.errorString()));
+    const QByteArray expected = expectedFile.readAll();
+
+    const int sockfd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sockfd == -1)
+        return fail(QStringLiteral("Unable to create socket: %1").arg(strerror(errno)));
+
+    sockaddr_un saddr = {};
+    saddr.sun_family = AF_UNIX;
+    const QByteArray socketPath = QFile::encodeName(arguments.at(0));
+    if (static_cast<size_t>(socketPath.size()) >= sizeof(saddr.sun_path))
+        return fail(QStringLiteral("Socket path is too long"));
+    std::memcpy(saddr.sun_path, socketPath.constData(), static_cast<size_t>(socketPath.size()));
+    unlink(saddr.sun_path);
+    if (bind(sockfd, reinterpret_cast<const sockaddr *>(&saddr), sizeof(saddr)) == -1)
+        return fail(QStringLiteral("Unable to bind %1: %2").arg(arguments.at(0), strerror(errno)));
+
+    QByteArray datagram(maxDatagramSize, Qt::Uninitialized);
+    iovec payload = {datagram.data(), maxDatagramSize};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message = {};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t size;
+    do {
+        size = recvmsg(sockfd, &message, MSG_CMSG_CLOEXEC);
+    } while (size == -1 && errno == EINTR);
+    close(sockfd);
+    unlink(saddr.sun_path);
+    if (size == -1)
+        return fail(QStringLiteral("Unable to receive command: %1").arg(strerror(errno)));
+    if (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+        return fail(QStringLiteral("Command was truncated"));
+    datagram.resize(static_cast<int>(size));
+
+    int fd = -1;
+    const cmsghdr *controlMessage = CMSG_FIRSTHDR(&message);
+    if (controlMessage && controlMessage->cmsg_level == SOL_SOCKET && controlMessage->cmsg_type == SCM_RIGHTS)
+        std::memcpy(&fd, CMSG_DATA(controlMessage), sizeof(int));
+
+    const QJsonObject command = QJsonDocument::fromJson(datagram).object();
+    const QString type = command.value(QStringLiteral("type")).toString();
+    const QJsonObject args = command.value(QStringLiteral("args")).toObject();
+    QTextStream output(stdout);
+
+    if (parser.isSet(inlineOption)) {
+        if (fd != -1)
+            return fail(QStringLiteral("Unexpected descriptor with inline command"));
+        if (type != QLatin1String("user_config"))
+            return fail(QStringLiteral("Expected user_config command, received: %1").arg(QString::fromUtf8(datagram)));
+        if (args.value(QStringLiteral("content")).toString().toUtf8() != expected)
+            return fail(QStringLiteral("Inline content does not match %1").arg(expectedFile.fileName()));
+
+        output << "received user_config bytes=" << expected.size() << '\n';
+        return 0;
+    }
+
+    if (type != QLatin1String("user_config_fd"))
+        return fail(QStringLiteral("Expected user_config_fd command, received: %1").arg(QString::fromUtf8(datagram)));
+    if (fd == -1)
+        return fail(QStringLiteral("No descriptor was passed with user_config_fd"));
+
+    const int seals = fcntl(fd, F_GET_SEALS);
+    if (seals == -1)
+        return fail(QStringLiteral("Unable to read seals: %1").arg(strerror(errno)));
+    if ((seals & allSeals) != allSeals)
+        return fail(QStringLiteral("Descriptor is not fully sealed: 0x%1").arg(seals, 0, 16));
+
+    struct stat status = {};
+    if (fstat(fd, &status) == -1)
+        return fail(QStringLiteral("Unable to stat descriptor: %1").arg(strerror(errno)));
+    const qint64 announcedSize = args.value(QStringLiteral("size")).toVariant().toLongLong();
+    if (announcedSize != status.st_size || status.st_size != expected.size())
+        return fail(QStringLiteral("Size mismatch: announced %1, descriptor %2, expected %3").arg(announcedSize).arg(status.st_size).arg(expected.size()));
+    if (readDescriptor(fd, status.st_size) != expected)
+        return fail(QStringLiteral("Descriptor content does not match %1").arg(expectedFile.fileName()));
+    close(fd);
+
+    output << "received user_config_fd bytes=" << expected.size() << " seals=0x" << QString::number(seals, 16) << '\n';
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QDBusMessage>
+#include <QStringList>
+#include <QTextStream>
+
+// StatusNotifierWatcher with a registered host that reports each item registration on stdout
+class MockStatusNotifierWatcher : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.StatusNotifierWatcher")
+    Q_PROPERTY(QStringList RegisteredStatusNotifierItems READ registeredItems)
+    Q_PROPERTY(bool IsStatusNotifierHostRegistered READ isHostRegistered)
+    Q_PROPERTY(int ProtocolVersion READ protocolVersion)
+    Q_DISABLE_COPY(MockStatusNotifierWatcher)
+
+public:
+    using QObject::QObject;
+
+    QStringList registeredItems() const
+    {
+        return m_items;
+    }
+
+    bool isHostRegistered() const
+    {
+        return true;
+    }
+
+    int protocolVersion() const
+    {
+        return 0;
+    }
+
+public slots:
+    void RegisterStatusNotifierItem(const QString &service, const QDBusMessage &message)
+    {
+        // Items may pass only an object path, then the sender is the service
+        const QString item = service.startsWith('/') ? message.service() + service : service;
+        m_items.append(item);
+        QTextStream output(stdout);
+        output << "registered " << item << '\n';
+        output.flush();
+        emit StatusNotifierItemRegistered(item);
+    }
+
+    void RegisterStatusNotifierHost(const QString &)
+    {
+    }
+
+signals:
+    void StatusNotifierItemRegistered(const QString &service);
+    void StatusNotifierItemUnregistered(const QString &service);
+    void StatusNotifierHostRegistered();
+
+private:
+    QStringList m_items;
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        QTextStream(stderr) << "Unable to connect to session bus: " << bus.lastError().message() << '\n';
+        return 1;
+    }
+
+    // Object is registered before the name, so items never see a name without it
+    MockStatusNotifierWatcher watcher;
+    if (!bus.registerObject(QStringLiteral("/StatusNotifierWatcher"), &watcher, QDBusConnection::ExportAllContents)
+        || !bus.registerService(QStringLiteral("org.kde.StatusNotifierWatcher"))) {
+        QTextStream(stderr) << "Unable to register mock watcher: " << bus.lastError().message() << '\n';
+        return 1;
+    }
+
+    return QCoreApplication::exec();
+}
+
+#include "mockstatusnotifierwatcher.moc"
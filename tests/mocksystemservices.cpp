@@ -0,0 +1,173 @@
+/*
+ *  Copyright © 2019-2022 Hennadii Chernyshchyk <genaloner@gmail.com>
+ *
+ *  This file is part of Optimus Manager Qt.
+ *
+ *  Optimus Manager Qt is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Optimus Manager Qt is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Optimus Manager Qt. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusObjectPath>
+#include <QDBusVariant>
+#include <QDBusVirtualObject>
+#include <QTextStream>
+#include <QTimer>
+
+#include <utility>
+
+// Minimal logind and systemd services for measuring preflight checks on a private bus
+namespace
+{
+struct MockSession {
+    QString sessionId;
+    uint userId;
+    QString userName;
+    QString seatId;
+    QDBusObjectPath sessionObjectPath;
+};
+
+QDBusArgument &operator<<(QDBusArgument &argument, const MockSession &session)
+{
+    argument.beginStructure();
+    argument << session.sessionId << session.userId << session.userName << session.seatId << session.sessionObjectPath;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, MockSession &session)
+{
+    argument.beginStructure();
+    argument >> session.sessionId >> session.userId >> session.userName >> session.seatId >> session.sessionObjectPath;
+    argument.endStructure();
+    return argument;
+}
+}
+
+Q_DECLARE_METATYPE(MockSession)
+Q_DECLARE_METATYPE(QList<MockSession>)
+
+namespace
+{
+class MockServices : public QDBusVirtualObject
+{
+    Q_DISABLE_COPY(MockServices)
+
+public:
+    MockServices(int sessionsCount, int latency, QString sessionType, QStringList runningUnits, QObject *parent = nullptr)
+        : QDBusVirtualObject(parent)
+        , m_sessionsCount(sessionsCount)
+        , m_latency(latency)
+        , m_sessionType(std::move(sessionType))
+        , m_runningUnits(std::move(runningUnits))
+    {
+    }
+
+    QString introspect(const QString &) const override
+    {
+        return {};
+    }
+
+    // Replies are delayed without blocking, so concurrent calls overlap like on a real bus
+    bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override
+    {
+        const QDBusMessage reply = createReply(message);
+        QTimer::singleShot(m_latency, [connection, reply] { connection.send(reply); });
+        return true;
+    }
+
+private:
+    QDBusMessage createReply(const QDBusMessage &message) const
+    {
+        if (message.member() == QLatin1String("ListSessions")) {
+            QList<MockSession> sessions;
+            for (int i = 1; i <= m_sessionsCount; ++i) {
+                const QString id = QString::number(i);
+                sessions.append({id, 1000, QStringLiteral("user"), QStringLiteral("seat0"), QDBusObjectPath(QStringLiteral("/org/freedesktop/login1/session/_3") + id)});
+            }
+            return message.createReply(QVariant::fromValue(sessions));
+        }
+
+        if (message.member() == QLatin1String("GetUnit")) {
+            const QString unit = message.arguments().value(0).toString();
+            if (!m_runningUnits.contains(unit))
+                return message.createErrorReply(QStringLiteral("org.freedesktop.systemd1.NoSuchUnit"), QStringLiteral("Unit %1 not loaded.").arg(unit));
+
+            QString escapedUnit = unit;
+            escapedUnit.replace(QLatin1Char('-'), QLatin1String("_2d")).replace(QLatin1Char('.'), QLatin1String("_2e"));
+            return message.createReply(QVariant::fromValue(QDBusObjectPath(QStringLiteral("/org/freedesktop/systemd1/unit/") + escapedUnit)));
+        }
+
+        if (message.interface() == QLatin1String("org.freedesktop.DBus.Properties") && message.member() == QLatin1String("Get")) {
+            const QString property = message.arguments().value(1).toString();
+            if (property == QLatin1String("Type"))
+                return message.createReply(QVariant::fromValue(QDBusVariant(m_sessionType)));
+            if (property == QLatin1String("SubState"))
+                return message.createReply(QVariant::fromValue(QDBusVariant(QStringLiteral("running"))));
+        }
+
+        return message.createErrorReply(QDBusError::UnknownMethod, QStringLiteral("Method %1 is not mocked").arg(message.member()));
+    }
+
+    const int m_sessionsCount;
+    const int m_latency;
+    const QString m_sessionType;
+    const QStringList m_runningUnits;
+};
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption sessionsOption(QStringLiteral("sessions"), QStringLiteral("Report <count> logind sessions."), QStringLiteral("count"), QStringLiteral("1"));
+    parser.addOption(sessionsOption);
+    const QCommandLineOption latencyOption(QStringLiteral("latency"), QStringLiteral("Delay every reply by <ms> milliseconds."), QStringLiteral("ms"), QStringLiteral("0"));
+    parser.addOption(latencyOption);
+    const QCommandLineOption sessionTypeOption(QStringLiteral("session-type"), QStringLiteral("Report <type> for every session."), QStringLiteral("type"), QStringLiteral("x11"));
+    parser.addOption(sessionTypeOption);
+    const QCommandLineOption runningUnitOption(QStringLiteral("running-unit"), QStringLiteral("Report <unit> as running, can be repeated."), QStringLiteral("unit"));
+    parser.addOption(runningUnitOption);
+    parser.process(app);
+
+    qDBusRegisterMetaType<MockSession>();
+    qDBusRegisterMetaType<QList<MockSession>>();
+
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (!bus.isConnected()) {
+        QTextStream(stderr) << "Unable to connect to system bus: " << bus.lastError().message() << '\n';
+        return 1;
+    }
+
+    MockServices services(parser.value(sessionsOption).toInt(), parser.value(latencyOption).toInt(),
+                          parser.value(sessionTypeOption), parser.values(runningUnitOption));
+
+    // Objects are registered before names, so callers never see a name without objects
+    if (!bus.registerVirtualObject(QStringLiteral("/org/freedesktop/login1"), &services, QDBusConnection::SubPath)
+        || !bus.registerVirtualObject(QStringLiteral("/org/freedesktop/systemd1"), &services, QDBusConnection::SubPath)
+        || !bus.registerService(QStringLiteral("org.freedesktop.login1"))
+        || !bus.registerService(QStringLiteral("org.freedesktop.systemd1"))) {
+        QTextStream(stderr) << "Unable to register mock services: " << bus.lastError().message() << '\n';
+        return 1;
+    }
+
+    return QCoreApplication::exec();
+}
@@ -0,0 +1,73 @@
+#!/bin/sh
+# Measures switch preflight time against mock logind and systemd on a private bus.
+# Usage: preflight-benchmark.sh <application> <mock services> <sessions> <latency ms> <runs> [sysroot]
+
+set -eu
+
+application=$1
+mock_services=$2
+sessions=$3
+latency=$4
+runs=$5
+sysroot=${6:-}
+
+workdir=$(mktemp -d)
+daemon_pid=
+mock_pid=
+cleanup() {
+    [ -n "$mock_pid" ] && kill "$mock_pid" 2>/dev/null
+    [ -n "$daemon_pid" ] && kill "$daemon_pid" 2>/dev/null
+    rm -rf "$workdir"
+}
+trap cleanup EXIT
+
+dbus-daemon --session --nofork --print-address=3 3>"$workdir/address" &
+daemon_pid=$!
+while [ ! -s "$workdir/address" ]; do
+    sleep 0.1
+done
+
+# Both buses point to the same daemon, the session bus keeps the benchmark away from a running instance
+DBUS_SYSTEM_BUS_ADDRESS=$(head -n 1 "$workdir/address")
+DBUS_SESSION_BUS_ADDRESS=$DBUS_SYSTEM_BUS_ADDRESS
+XDG_CONFIG_HOME=$workdir/config
+export DBUS_SYSTEM_BUS_ADDRESS DBUS_SESSION_BUS_ADDRESS XDG_CONFIG_HOME
+
+"$mock_services" --sessions "$sessions" --latency "$latency" --running-unit optimus-manager.service &
+mock_pid=$!
+until dbus-send --bus="$DBUS_SYSTEM_BUS_ADDRESS" --print-reply --dest=org.freedesktop.DBus /org/freedesktop/DBus \
+    org.freedesktop.DBus.NameHasOwner string:org.freedesktop.systemd1 2>/dev/null | grep -q 'boolean true'; do
+    sleep 0.1
+done
+
+run=0
+while [ "$run" -lt "$runs" ]; do
+    if [ -n "$sysroot" ]; then
+        "$application" --preflight --sysroot "$sysroot" >>"$workdir/results"
+    else
+        "$application" --preflight >>"$workdir/results"
+    fi
+    run=$((run + 1))
+done
+
+awk -v sessions="$sessions" -v latency="$latency" '
+{
+    for (i = 1; i <= NF; ++i) {
+        split($i, field, "=")
+        value[field[1]] = field[2]
+    }
+    if (value["sessions"] != sessions) {
+        printf "expected %d sessions, got %d\n", sessions, value["sessions"]
+        failed = 1
+    }
+    duration = value["duration_us"] + 0
+    total += duration
+    if (NR == 1 || duration < min)
+        min = duration
+    if (duration > max)
+        max = duration
+}
+END {
+    printf "sessions=%d latency_ms=%d runs=%d min_us=%d avg_us=%d max_us=%d\n", sessions, latency, NR, min, total / NR, max
+    exit failed
+}' "$workdir/results"
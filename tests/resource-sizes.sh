@@ -0,0 +1,18 @@
+#!/bin/sh
+# Compares the size of the executable, external icon resources and the same resources compiled into a library.
+# Usage: resource-sizes.sh <application> <embedded resources library> <rcc file>...
+
+set -eu
+
+application=$1
+embedded_resources=$2
+shift 2
+
+rcc_size=0
+for rcc in "$@"; do
+    rcc_size=$((rcc_size + $(stat -c %s "$rcc")))
+done
+
+application_size=$(stat -c %s "$application")
+embedded_size=$(stat -c %s "$embedded_resources")
+echo "executable_bytes=$application_size external_rcc_bytes=$rcc_size embedded_resources_bytes=$embedded_size embedded_executable_bytes=$((application_size + embedded_size))"
@@ -0,0 +1,93 @@
+#!/bin/sh
+# Measures tray startup time until the item is registered with a mock StatusNotifierWatcher,
+# idle resident and proportional set sizes and the number of loaded shared libraries.
+# Usage: tray-benchmark.sh <application> <mock watcher> <label> <runs> [preloaded library]
+
+set -eu
+
+application=$1
+mock_watcher=$2
+label=$3
+runs=$4
+preload=${5:-}
+
+workdir=$(mktemp -d)
+daemon_pid=
+watcher_pid=
+application_pid=
+cleanup() {
+    [ -n "$application_pid" ] && kill "$application_pid" 2>/dev/null
+    [ -n "$watcher_pid" ] && kill "$watcher_pid" 2>/dev/null
+    [ -n "$daemon_pid" ] && kill "$daemon_pid" 2>/dev/null
+    rm -rf "$workdir"
+}
+trap cleanup EXIT
+
+# Milliseconds since the epoch
+now() {
+    echo $(($(date +%s%N) / 1000000))
+}
+
+dbus-daemon --session --nofork --print-address=3 3>"$workdir/address" &
+daemon_pid=$!
+while [ ! -s "$workdir/address" ]; do
+    sleep 0.1
+done
+
+# System bus calls of the tray also go to the private daemon
+DBUS_SESSION_BUS_ADDRESS=$(head -n 1 "$workdir/address")
+DBUS_SYSTEM_BUS_ADDRESS=$DBUS_SESSION_BUS_ADDRESS
+XDG_CONFIG_HOME=$workdir/config
+QT_QPA_PLATFORM=${QT_QPA_PLATFORM:-offscreen}
+export DBUS_SESSION_BUS_ADDRESS DBUS_SYSTEM_BUS_ADDRESS XDG_CONFIG_HOME QT_QPA_PLATFORM
+
+"$mock_watcher" >"$workdir/registrations" &
+watcher_pid=$!
+until dbus-send --bus="$DBUS_SESSION_BUS_ADDRESS" --print-reply --dest=org.freedesktop.DBus /org/freedesktop/DBus \
+    org.freedesktop.DBus.NameHasOwner string:org.kde.StatusNotifierWatcher 2>/dev/null | grep -q 'boolean true'; do
+    sleep 0.1
+done
+
+run=0
+while [ "$run" -lt "$runs" ]; do
+    start=$(now)
+    if [ -n "$preload" ]; then
+        LD_PRELOAD=$preload "$application" &
+    else
+        "$application" &
+    fi
+    application_pid=$!
+
+    deadline=$((start + 30000))
+    until [ "$(wc -l <"$workdir/registrations")" -gt "$run" ]; do
+        if [ "$(now)" -gt "$deadline" ]; then
+            echo "$label: tray item was not registered in 30 seconds" >&2
+            exit 1
+        fi
+        sleep 0.01
+    done
+    startup=$(($(now) - start))
+
+    # Let deferred initialization finish before measuring idle memory
+    sleep 2
+    rss=$(awk '$1 == "Rss:" { print $2 }' "/proc/$application_pid/smaps_rollup")
+    pss=$(awk '$1 == "Pss:" { print $2 }' "/proc/$application_pid/smaps_rollup")
+    libraries=$(awk '$6 ~ /\.so/ { print $6 }' "/proc/$application_pid/maps" | sort -u | wc -l)
+    echo "$startup $rss $pss $libraries" >>"$workdir/results"
+
+    kill "$application_pid"
+    wait "$application_pid" || true
+    application_pid=
+    run=$((run + 1))
+done
+
+awk -v label="$label" '
+{
+    startup += $1
+    rss += $2
+    pss += $3
+    libraries = $4
+}
+END {
+    printf "%s: runs=%d startup_ms=%d rss_kb=%d pss_kb=%d libraries=%d\n", label, NR, startup / NR, rss / NR, pss / NR, libraries
+}' "$workdir/results"